@@ -284,6 +284,9 @@ public:
 
     void AddObjectIds(TArray<uint32>& TetMeshIds, TArray<uint32>& RigidBodyIds);
 
+    /** Called by the scene after it has been recreated, swaps in the copies of this actor's rigid bodies and refreshes buffer ids */
+    void RebindSceneObjects(const TMap<AMD::FmRigidBody*, AMD::FmRigidBody*>& RigidBodyMap);
+
 private:
 	void CreateIdMapping();
 
@@ -33,6 +33,7 @@ namespace AMD
 	struct FmRigidBody;
     struct FmRigidBodySetupParams;
 	struct FmTetMeshBuffer;
+	struct FmTetMeshBufferBounds;
 	struct FmTetMesh;
 	struct FmTetVertIds;
 	struct FmTet;
@@ -8,6 +8,8 @@
 
 #include "AMD_FEMFX.h"
 #include "CoreMinimal.h"
+#include "FEMFXPackedRotation.h"
+#include "FEMMeshTypes.h"
 
 // FEMFX simulation uses a right-handed coordinate system, and samples convention is Y is up.
 // Unreal world is left-handed and Z-up.
@@ -25,6 +27,14 @@ static inline AMD::FmVector3 ConvertUnrealToFEMFXVector(const FVector& vec)
 	return AMD::FmVector3(vec.Y, vec.Z, -vec.X);
 }
 
+// Converts a FEMFX box to an Unreal box in centimetres. Negating Z swaps which corner is the minimum along Unreal X.
+static inline FBox ConvertFEMFXBoundsToUnreal(const AMD::FmVector3& MinPosition, const AMD::FmVector3& MaxPosition)
+{
+	return FBox(
+		FVector(-MaxPosition.z, MinPosition.x, MinPosition.y) * 100.0f,
+		FVector(-MinPosition.z, MaxPosition.x, MaxPosition.y) * 100.0f);
+}
+
 // To convert a local to world rotation from FEMFX to Unreal, first assuming that the local space coordinates 
 // will first be transformed to Unreal coordinates as above.
 // The rotation frame axes (which are expressed in the world) must also be converted to Unreal coordinates.
@@ -73,3 +83,216 @@ static inline AMD::FmMatrix3 ConvertUnrealAxesToFEMFXMatrix(const FVector& XAxis
 	result.col2 = -ConvertUnrealToFEMFXVector(XAxis);
 	return result;
 }
+
+// Batched versions of the conversions above for the per-frame render data. Four vertices are gathered into the SoA types
+// of the FEMFX Vectormath library, so the axis swap, scale, quaternion normalize and rotation build run on all lanes at once.
+// Callers fill lanes past the end of their data by repeating the last real vertex.
+static const int32 FEMFXSoaWidth = 4;
+
+typedef AMD::FmSoa4Types FEMFXSoaTypes;
+
+/** Per-lane bounds of converted positions, reduced to an FBox once all batches are done */
+struct FFEMFXSoaBounds
+{
+	FEMFXSoaTypes::SoaVector3 Min;
+	FEMFXSoaTypes::SoaVector3 Max;
+
+	FFEMFXSoaBounds()
+		: Min(FEMFXSoaTypes::SoaFloat(FLT_MAX))
+		, Max(FEMFXSoaTypes::SoaFloat(-FLT_MAX))
+	{
+	}
+
+	FBox ToBox() const
+	{
+		float MinX[FEMFXSoaWidth], MinY[FEMFXSoaWidth], MinZ[FEMFXSoaWidth];
+		float MaxX[FEMFXSoaWidth], MaxY[FEMFXSoaWidth], MaxZ[FEMFXSoaWidth];
+		_mm_storeu_ps(MinX, Min.getX().get128());
+		_mm_storeu_ps(MinY, Min.getY().get128());
+		_mm_storeu_ps(MinZ, Min.getZ().get128());
+		_mm_storeu_ps(MaxX, Max.getX().get128());
+		_mm_storeu_ps(MaxY, Max.getY().get128());
+		_mm_storeu_ps(MaxZ, Max.getZ().get128());
+
+		FBox Box(ForceInit);
+		for (int32 Lane = 0; Lane < FEMFXSoaWidth; Lane++)
+		{
+			if (MinX[Lane] <= MaxX[Lane])
+			{
+				Box += FBox(FVector(MinX[Lane], MinY[Lane], MinZ[Lane]), FVector(MaxX[Lane], MaxY[Lane], MaxZ[Lane]));
+			}
+		}
+		return Box;
+	}
+};
+
+/** Converts In[0..3] to Unreal centimetres, writing the first NumOut to Out. Every lane counts towards Bounds */
+static inline void ConvertFEMFXPositionsToUnreal4(FVector* Out, int32 NumOut, const AMD::FmVector3* In, FFEMFXSoaBounds& Bounds)
+{
+	typedef FEMFXSoaTypes::SoaFloat SoaFloat;
+
+	const SoaFloat Scale(100.0f);
+	const FEMFXSoaTypes::SoaVector3 Pos(
+		-SoaFloat(In[0].getZ(), In[1].getZ(), In[2].getZ(), In[3].getZ()) * Scale,
+		SoaFloat(In[0].getX(), In[1].getX(), In[2].getX(), In[3].getX()) * Scale,
+		SoaFloat(In[0].getY(), In[1].getY(), In[2].getY(), In[3].getY()) * Scale);
+
+	Bounds.Min = FmVectormath::min(Bounds.Min, Pos);
+	Bounds.Max = FmVectormath::max(Bounds.Max, Pos);
+
+	float X[FEMFXSoaWidth], Y[FEMFXSoaWidth], Z[FEMFXSoaWidth];
+	_mm_storeu_ps(X, Pos.getX().get128());
+	_mm_storeu_ps(Y, Pos.getY().get128());
+	_mm_storeu_ps(Z, Pos.getZ().get128());
+
+	for (int32 Lane = 0; Lane < NumOut; Lane++)
+	{
+		Out[Lane] = FVector(X[Lane], Y[Lane], Z[Lane]);
+	}
+}
+
+/** Normalizes the vertex quaternion sums In[0..3], converts them to Unreal space and packs the first NumOut into Out */
+static inline void PackFEMFXQuatSumsToUnreal4(FFEMFXMeshPackedRotation* Out, int32 NumOut, const AMD::FmQuat* In)
+{
+	typedef FEMFXSoaTypes::SoaFloat SoaFloat;
+
+	const FEMFXSoaTypes::SoaQuat Quat = normalize(FEMFXSoaTypes::SoaQuat(
+		SoaFloat(In[0].getX(), In[1].getX(), In[2].getX(), In[3].getX()),
+		SoaFloat(In[0].getY(), In[1].getY(), In[2].getY(), In[3].getY()),
+		SoaFloat(In[0].getZ(), In[1].getZ(), In[2].getZ(), In[3].getZ()),
+		SoaFloat(In[0].getW(), In[1].getW(), In[2].getW(), In[3].getW())));
+
+	// The axis remap and column permutation of ConvertFEMFXTetRotationToUnreal together are a rotation, which on the
+	// quaternion is (x, y, z, w) -> (z, -x, -y, w). Encoded as EncodeFEMFXSnorm16 does, four lanes at a time.
+	const SoaFloat Scale(FEMFXSnorm16Scale);
+	__m128i X = _mm_cvtps_epi32((Quat.getZ() * Scale).get128());
+	__m128i Y = _mm_cvtps_epi32((-Quat.getX() * Scale).get128());
+	__m128i Z = _mm_cvtps_epi32((-Quat.getY() * Scale).get128());
+	__m128i W = _mm_cvtps_epi32((Quat.getW() * Scale).get128());
+
+	// Transpose to one quaternion per lane, then saturate to 16 bits
+	__m128i XY01 = _mm_unpacklo_epi32(X, Y);
+	__m128i XY23 = _mm_unpackhi_epi32(X, Y);
+	__m128i ZW01 = _mm_unpacklo_epi32(Z, W);
+	__m128i ZW23 = _mm_unpackhi_epi32(Z, W);
+	__m128i Packed01 = _mm_packs_epi32(_mm_unpacklo_epi64(XY01, ZW01), _mm_unpackhi_epi64(XY01, ZW01));
+	__m128i Packed23 = _mm_packs_epi32(_mm_unpacklo_epi64(XY23, ZW23), _mm_unpackhi_epi64(XY23, ZW23));
+
+	if (NumOut == FEMFXSoaWidth)
+	{
+		_mm_storeu_si128((__m128i*)Out, Packed01);
+		_mm_storeu_si128((__m128i*)(Out + 2), Packed23);
+	}
+	else
+	{
+		FFEMFXMeshPackedRotation Lanes[FEMFXSoaWidth];
+		_mm_storeu_si128((__m128i*)Lanes, Packed01);
+		_mm_storeu_si128((__m128i*)(Lanes + 2), Packed23);
+		FMemory::Memcpy(Out, Lanes, NumOut * sizeof(FFEMFXMeshPackedRotation));
+	}
+}
+
+/** Packs an Unreal space rotation matrix given by its columns, used for the rotations stored with the tet mesh asset */
+static inline FFEMFXMeshPackedRotation PackFEMFXRotation(const FFEMFXMeshTetRotation& Rotation)
+{
+	FQuat Quat(FMatrix(Rotation.Col0, Rotation.Col1, Rotation.Col2, FVector::ZeroVector));
+	const float Components[4] = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+
+	int16_t Encoded[4];
+	PackFEMFXQuatSnorm16(Encoded, Components);
+
+	FFEMFXMeshPackedRotation Packed;
+	Packed.X = Encoded[0];
+	Packed.Y = Encoded[1];
+	Packed.Z = Encoded[2];
+	Packed.W = Encoded[3];
+	return Packed;
+}
+
+static inline void PackFEMFXRotations(TArray<FFEMFXMeshPackedRotation>& Out, const TArray<FFEMFXMeshTetRotation>& Rotations)
+{
+	Out.SetNumUninitialized(Rotations.Num(), false);
+	for (int32 Idx = 0; Idx < Rotations.Num(); Idx++)
+	{
+		Out[Idx] = PackFEMFXRotation(Rotations[Idx]);
+	}
+}
+
+/**
+ * Reference for the decode in FEMFXMeshVertexFactory.ush. The rotation matrix columns, as in FFEMFXMeshTetRotation, are
+ * GetAxisX(), GetAxisY() and GetAxisZ() of the result. Quantization error is below 1e-4 radians.
+ */
+static inline FQuat UnpackFEMFXRotation(const FFEMFXMeshPackedRotation& Packed)
+{
+	const int16_t Encoded[4] = { Packed.X, Packed.Y, Packed.Z, Packed.W };
+
+	float Components[4];
+	UnpackFEMFXQuatSnorm16(Components, Encoded);
+	return FQuat(Components[0], Components[1], Components[2], Components[3]);
+}
+
+// Sub-mesh indices of packed positions are 16 bit
+static const int32 FEMFXMaxPackedPositionSubMeshes = 65536;
+static const float FEMFXPackedPositionMaxValue = 65535.0f;
+
+/**
+ * Packs Positions to 16 bits per component relative to the bounds of each sub-mesh, SubMeshVertOffsets giving the first
+ * vertex of each. The error per component is at most half of the sub-mesh's extent / 65535 along that axis.
+ * SubMeshVertOffsets must have at most FEMFXMaxPackedPositionSubMeshes entries.
+ */
+static inline void PackFEMFXPositions(TArray<FFEMFXMeshPackedPosition>& OutPositions, TArray<FFEMFXMeshPositionBounds>& OutBounds,
+	const TArray<FVector>& Positions, const TArray<int32>& SubMeshVertOffsets)
+{
+	check(SubMeshVertOffsets.Num() <= FEMFXMaxPackedPositionSubMeshes);
+
+	const int32 NumVerts = Positions.Num();
+	const int32 NumSubMeshes = SubMeshVertOffsets.Num();
+	OutPositions.SetNumUninitialized(NumVerts, false);
+	OutBounds.SetNumUninitialized(NumSubMeshes, false);
+
+	for (int32 MeshIdx = 0; MeshIdx < NumSubMeshes; MeshIdx++)
+	{
+		const int32 BeginIdx = SubMeshVertOffsets[MeshIdx];
+		const int32 EndIdx = MeshIdx + 1 < NumSubMeshes ? SubMeshVertOffsets[MeshIdx + 1] : NumVerts;
+
+		FVector Min(BIG_NUMBER);
+		FVector Max(-BIG_NUMBER);
+		for (int32 VertIdx = BeginIdx; VertIdx < EndIdx; VertIdx++)
+		{
+			Min = Min.ComponentMin(Positions[VertIdx]);
+			Max = Max.ComponentMax(Positions[VertIdx]);
+		}
+
+		// A sub-mesh that is flat along an axis packs zeros along it
+		const FVector Step = (EndIdx > BeginIdx) ? (Max - Min) / FEMFXPackedPositionMaxValue : FVector::ZeroVector;
+		const FVector InvStep(
+			Step.X > 0.0f ? 1.0f / Step.X : 0.0f,
+			Step.Y > 0.0f ? 1.0f / Step.Y : 0.0f,
+			Step.Z > 0.0f ? 1.0f / Step.Z : 0.0f);
+
+		FFEMFXMeshPositionBounds& Bounds = OutBounds[MeshIdx];
+		Bounds.Min = FVector4(EndIdx > BeginIdx ? Min : FVector::ZeroVector, 0.0f);
+		Bounds.Step = FVector4(Step, 0.0f);
+
+		for (int32 VertIdx = BeginIdx; VertIdx < EndIdx; VertIdx++)
+		{
+			const FVector Scaled = (Positions[VertIdx] - Min) * InvStep;
+
+			FFEMFXMeshPackedPosition& Packed = OutPositions[VertIdx];
+			Packed.X = (uint16)FMath::Clamp(FMath::RoundToInt(Scaled.X), 0, 65535);
+			Packed.Y = (uint16)FMath::Clamp(FMath::RoundToInt(Scaled.Y), 0, 65535);
+			Packed.Z = (uint16)FMath::Clamp(FMath::RoundToInt(Scaled.Z), 0, 65535);
+			Packed.SubMeshIndex = (uint16)MeshIdx;
+		}
+	}
+}
+
+/** Reference for LoadTetMeshVertexPosition in FEMFXMeshVertexFactory.ush */
+static inline FVector UnpackFEMFXPosition(const FFEMFXMeshPackedPosition& Packed, const TArray<FFEMFXMeshPositionBounds>& Bounds)
+{
+	const FFEMFXMeshPositionBounds& SubMeshBounds = Bounds[Packed.SubMeshIndex];
+	return FVector(
+		SubMeshBounds.Min.X + Packed.X * SubMeshBounds.Step.X,
+		SubMeshBounds.Min.Y + Packed.Y * SubMeshBounds.Step.Y,
+		SubMeshBounds.Min.Z + Packed.Z * SubMeshBounds.Step.Z);
+}
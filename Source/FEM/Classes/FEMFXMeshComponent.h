@@ -21,6 +21,7 @@
 #include "RenderTetAssignment.h"
 #include "TetBlueprintHelpers.h"
 #include "PrimitiveSceneProxy.h"
+#include "HAL/ThreadSafeBool.h"
 
 #include "FEMFXMeshComponent.generated.h"
 
@@ -62,6 +63,29 @@ public:
 	TArray<int32> AddedIndexBuffer;
 };
 
+/**
+*	One render update of the simulated tet mesh, filled in place on the game thread and uploaded from on the render thread.
+*	Arrays that are empty leave the matching buffer as it is. They keep their allocations between updates.
+*/
+class FFEMFXMeshStagingSlot
+{
+public:
+	TArray<FVector> Positions;
+	TArray<FFEMFXMeshPackedPosition> PackedPositions;
+	TArray<FFEMFXMeshPositionBounds> PositionBounds;
+	TArray<FFEMFXMeshPackedRotation> Rotations;
+	TArray<float> Deformations;
+	TArray<FFEMFXMeshTetVertexIds> TetVertexIds;
+
+	/** Read PackedPositions and PositionBounds instead of Positions */
+	bool bPackedPositions;
+
+	/** Set from submit until the render thread has uploaded the slot */
+	FThreadSafeBool bInFlight;
+
+	FFEMFXMeshStagingSlot() : bPackedPositions(false) {}
+};
+
 /** Procedural mesh scene proxy */
 class FFEMFXMeshSceneProxy : public FPrimitiveSceneProxy
 {
@@ -82,7 +106,7 @@ public:
 	uint32 GetAllocatedSize(void) const;
 
 	void UpdateRenderData(const TArray<FVector>& NewVertexPositions,
-		                  const TArray<FFEMFXMeshTetRotation>& NewVertexRotations,
+		                  const TArray<FFEMFXMeshPackedRotation>& NewVertexRotations,
 		                  const TArray<FFEMFXMeshTetVertexIds>& NewTetVertexIds,
 						  const TArray<float>& NewDeformations,
 		                  bool PadVerticesForFracture);
@@ -93,8 +117,15 @@ public:
 	void UpdateSection(int32 SectionIdx, const TArray<int32>& NewBarycentricPosIds);
 	void UpdateSection(int32 SectionIdx, const TArray<FFEMFXMeshBarycentricPos>& NewBarycentricPositions);
 
-	void UpdateTetMesh(const FFEMTetMeshRenderData RenderData, bool PadVerticesForFracture);
-	void UpdateTetMesh(const TArray<FVector>& NewVertexPositions, const TArray<FFEMFXMeshTetRotation>& NewVertexRotations, const TArray<float>& NewDeformations, bool PadVerticesForFracture);
+	void UpdateTetMesh(const FFEMTetMeshRenderData& RenderData, bool PadVerticesForFracture);
+	void UpdateTetMesh(const TArray<FVector>& NewVertexPositions, const TArray<FFEMFXMeshPackedRotation>& NewVertexRotations, const TArray<float>& NewDeformations, bool PadVerticesForFracture);
+
+	/**
+	 * Returns the next slot of the staging ring for the game thread to fill, emptied, or nullptr while the render thread
+	 * is still uploading it. Must be followed by SubmitStagingSlot before asking for another one.
+	 */
+	FFEMFXMeshStagingSlot* BeginStagingSlot();
+	void SubmitStagingSlot(FFEMFXMeshStagingSlot* Slot, bool PadVerticesForFracture);
 	void UpdateTetVertexIds(const TArray<FFEMFXMeshTetVertexIds>& NewTetVertexIds);
 
 	void SetSectionVisibility_RenderThread(int32 SectionIndex, bool bNewVisibility);
@@ -108,12 +139,24 @@ private:
 
 	FStructuredBufferAndSRV<FFEMFXMeshTetVertexIds> TetVertexIds;              // Per-tetrahedron vertex ids in FEM mesh
 	FStructuredBufferAndSRV<FVector> TetMeshVertexPositions;                   // Tet mesh vertex positions
-	FStructuredBufferAndSRV<FFEMFXMeshTetRotation> TetMeshVertexRotations;     // Tet mesh vertex rotations
+	FStructuredBufferAndSRV<FFEMFXMeshPackedPosition> TetMeshVertexPackedPositions;  // Tet mesh vertex positions when packed
+	FStructuredBufferAndSRV<FFEMFXMeshPositionBounds> TetMeshPositionBounds;   // Per sub-mesh bounds of the packed positions
+	bool bPackedPositions;                                                     // Which position stream the last update wrote, render thread only
+	FStructuredBufferAndSRV<FFEMFXMeshPackedRotation> TetMeshVertexRotations;  // Tet mesh vertex rotations, packed quaternions
 	FStructuredBufferAndSRV<float> TetMeshDeformations;
 
+	// Staging ring for the per-frame updates. Three slots let the game thread fill one while the render thread uploads
+	// another and a third is queued, without waiting on or allocating for either.
+	static const int32 NumStagingSlots = 3;
+	FFEMFXMeshStagingSlot StagingSlots[NumStagingSlots];
+	int32 NextStagingSlot;
+
 	UFEMFXMeshComponent* Component;
 
 	FMaterialRelevance MaterialRelevance;
+
+	void SetPackedPositions(bool bPacked);
+	void UploadStagingSlot_RenderThread(FFEMFXMeshStagingSlot* Slot, bool PadVerticesForFracture);
 };
 
 
@@ -160,6 +203,7 @@ struct FEMCollision
 	TArray<float> BarCentricPositions;
 };
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnFEMCollision, FEMCollision, Collision);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnFEMCollisions, TArray<FEMCollision>, Collisions);
 
 USTRUCT(BlueprintType)
 struct FFEMFracture
@@ -293,6 +337,32 @@ public:
 	UFUNCTION()
 	void UpdateSceneProxy();
 
+	/** Read the simulated state into SimRenderData after a step; the previously captured positions become the interpolation start */
+	void CaptureSimState();
+
+	/** Read positions before the last step of a frame that runs several steps, so interpolation starts from the step just before it */
+	void CaptureStepStartPositions();
+
+	/** Send the captured state to the render thread, with positions blended from the previous step by Alpha */
+	void UpdateSceneProxyInterpolated(float Alpha);
+
+	/** Called by the scene instead of CaptureSimState when none of the sub-meshes moved; the last captured state is shown once and then left alone */
+	void MarkSimStateUnchanged();
+
+	/** Drop the interpolation start so the next frames show the captured state as is, used after the state jumps */
+	void ResetRenderInterpolation();
+
+	/** Scale the authored maxUnconstrainedSolveIterations, used by the scene budget governor. Skipped for meshes with per-tet materials. */
+	void SetSolveIterationScale(float Scale, int32 MinIterations);
+
+	/** Upload tet mesh positions as 16 bit values relative to each sub-mesh's bounds, 8 bytes per vertex instead of 12 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
+	bool bPackRenderPositions;
+
+	/** Packs the captured positions and logs how far they decode from the float ones. Returns the largest distance, in cm. */
+	UFUNCTION(BlueprintCallable, Category = "FEM")
+	float MeasurePackedPositionError();
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	bool EditorOnly;
 
@@ -308,6 +378,8 @@ private:
     void UpdateLocalBounds();
     /** Mark collision data as dirty, and re-create on instance if necessary */
     void UpdateCollision();
+    /** Block until the scene's asynchronous step is done with the tet mesh buffer, called before any API touching it */
+    void WaitForSceneUpdate();
 
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
@@ -343,15 +415,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "FEM")
 	TArray<FTetQueryData> ApplyExplosionForce(const FVector& origin, float shokwavePressure0, float shokwaveArea0, float speed, float timestep, float timeSinceDetonation);
 
+	/** Broadcast once per contact. Prefer CollisionsEvent, this is only fired when something is bound to it. */
 	UPROPERTY(EditAnywhere, BlueprintAssignable, Category = "FEM")
 	FOnFEMCollision CollisionEvent;
 
+	/** Broadcast once per scene update with all contacts reported for this component */
+	UPROPERTY(EditAnywhere, BlueprintAssignable, Category = "FEM")
+	FOnFEMCollisions CollisionsEvent;
+
 	UPROPERTY(EditAnywhere, BlueprintAssignable, Category = "FEM")
 	FOnFEMFracture FractureEvent;
 
 	UFUNCTION(BlueprintNativeEvent, CallInEditor, BlueprintCallable, Category = "FEM")
 	void OnHit(FEMCollision otherComponent);
 
+	/** Called once per scene update with all contacts reported for this component. By default forwards each contact to OnHit. */
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "FEM")
+	void OnHits(const TArray<FEMCollision>& Collisions);
+
 	UFUNCTION(BlueprintCallable, Category = "FEM")
 	void ResetFromRestPosition(FTransform transform, FVector velocity);
 
@@ -363,6 +444,12 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "FEM")
 	void LoadSimObject();
 
+	/** Bounds of the tet mesh buffer LoadSimObject would create, used by the scene to size itself. False if there is nothing to simulate */
+	bool ComputeTetMeshBufferBounds(AMD::FmTetMeshBufferBounds& OutBounds) const;
+
+	/** Takes over a copy of the tet mesh buffer made when the scene was recreated, freeing the current one */
+	void RebindTetMeshBuffer(AMD::FmTetMeshBuffer* NewTetMeshBuffer);
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	TMap<FString, UFEMFXTetMeshParameters*> MeshParameters;
 
@@ -386,6 +473,12 @@ public:
 
 	void UpdateRenderingDataFromFracture();
 
+	/** First half of UpdateRenderingDataFromFracture, reads the faces exposed by fracture. Only touches this component, so it may run on a worker thread */
+	void GatherFractureData();
+
+	/** Second half of UpdateRenderingDataFromFracture, broadcasts FractureEvent on the game thread */
+	void BroadcastFractureData();
+
 	unsigned int GetBufferId();
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
@@ -435,4 +528,40 @@ private:
     TArray<int32> ExposedTriangleVertexIndices; // Array to hold exposed triangle indices collected during fracture; TODO: support multiple mesh sections
 
     TArray<FShardVertTetAssignments> UpdatingShardVertTetAssignmentsBuffer;
+
+    // Simulated state from the latest step, plus positions from the step before for render interpolation
+    FFEMTetMeshRenderData SimRenderData;
+    FBox SimBounds;
+    TArray<FVector> PreviousSimPositions;
+    FBox PreviousSimBounds;
+    TArray<FVector> StepStartPositions;
+    FBox StepStartBounds;
+    bool bHasStepStartPositions;
+    TArray<FVector> InterpolatedPositions;
+    TArray<FFEMFXMeshPackedPosition> PackedPositions;
+    TArray<FFEMFXMeshPositionBounds> PackedPositionBounds;
+
+    // First vertex of each sub-mesh in the staging arrays above, reused across captures
+    TArray<int32> SubMeshVertOffsets;
+
+    // Tet vertex ids only change with fracture or a new tet mesh buffer, either of which bumps TopologyGeneration.
+    // They are rebuilt and sent to the proxy only when the generation they were made for falls behind.
+    uint32 TopologyGeneration;
+    uint32 CapturedTopologyGeneration;
+    int32 CapturedTopologyNumSubMeshes;
+    uint32 UploadedTopologyGeneration;
+
+    // Bumped by each capture, rotations and deformations are only staged for the proxy when it is ahead of the upload
+    uint32 CapturedStateGeneration;
+    uint32 UploadedStateGeneration;
+
+    // Set while the mesh is not moving, so capture and upload can be skipped once the final state has been sent
+    bool bSimStateUnchanged;
+    bool bUnchangedStateUploaded;
+
+    int32 AppliedSolveIterations;
+
+    TArray<FFEMFracture> PendingFractureData;
+
+    void ReadSimPositions(TArray<FVector>& OutPositions, FBox& OutBounds);
 };
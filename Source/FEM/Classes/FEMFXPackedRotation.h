@@ -0,0 +1,66 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Snorm16 encoding of the unit quaternions that carry tet mesh vertex rotations to the GPU, see FFEMFXMeshPackedRotation.
+// Only depends on the C++ standard library, so it is tested on its own in Tests/.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+static const float FEMFXSnorm16Scale = 32767.0f;
+
+/** Rounds to nearest even and saturates, like the _mm_cvtps_epi32 and _mm_packs_epi32 in PackFEMFXQuatSumsToUnreal4 */
+static inline int16_t EncodeFEMFXSnorm16(float Value)
+{
+	float Scaled = rintf(Value * FEMFXSnorm16Scale);
+	return (int16_t)(Scaled < -32768.0f ? -32768.0f : (Scaled > 32767.0f ? 32767.0f : Scaled));
+}
+
+/** -32768 and -32767 both decode to -1 */
+static inline float DecodeFEMFXSnorm16(int16_t Value)
+{
+	float Decoded = Value / FEMFXSnorm16Scale;
+	return Decoded < -1.0f ? -1.0f : Decoded;
+}
+
+/**
+ * Normalizes Quat, given as (x, y, z, w), and encodes it. The sign is kept as it is: q and -q are the same rotation, and
+ * the vertex factory flips the quaternions it blends into the hemisphere of the first one, so the encode doesn't have to.
+ */
+static inline void PackFEMFXQuatSnorm16(int16_t Out[4], const float Quat[4])
+{
+	float Length = sqrtf(Quat[0] * Quat[0] + Quat[1] * Quat[1] + Quat[2] * Quat[2] + Quat[3] * Quat[3]);
+	float Scale = Length > 0.0f ? 1.0f / Length : 0.0f;
+	for (int Idx = 0; Idx < 4; Idx++)
+	{
+		Out[Idx] = EncodeFEMFXSnorm16(Quat[Idx] * Scale);
+	}
+}
+
+/** Decodes and renormalizes, the identity if all components are zero */
+static inline void UnpackFEMFXQuatSnorm16(float Out[4], const int16_t Packed[4])
+{
+	for (int Idx = 0; Idx < 4; Idx++)
+	{
+		Out[Idx] = DecodeFEMFXSnorm16(Packed[Idx]);
+	}
+
+	float Length = sqrtf(Out[0] * Out[0] + Out[1] * Out[1] + Out[2] * Out[2] + Out[3] * Out[3]);
+	if (Length > 0.0f)
+	{
+		for (int Idx = 0; Idx < 4; Idx++)
+		{
+			Out[Idx] /= Length;
+		}
+	}
+	else
+	{
+		Out[0] = Out[1] = Out[2] = 0.0f;
+		Out[3] = 1.0f;
+	}
+}
@@ -219,6 +219,9 @@ public:
 
 protected:
     FShaderResourceParameter TetMeshVertexPosBufferParameter;
+    FShaderResourceParameter TetMeshVertexPackedPosBufferParameter;
+    FShaderResourceParameter TetMeshPositionBoundsBufferParameter;
+    FShaderParameter TetMeshVertexPosPackedParameter;
     FShaderResourceParameter TetMeshVertexRotBufferParameter;
 	FShaderResourceParameter TetMeshDeformationBufferParameter;
     FShaderResourceParameter TetVertexIdBufferParameter;
@@ -229,11 +232,16 @@ protected:
 // User data for vertex shader.   Includes the structured buffer SRVs to support deformation of render mesh by tet mesh.
 struct FFEMFXMeshBatchElementParams
 {
-    FFEMFXMeshBatchElementParams() {  }
+    FFEMFXMeshBatchElementParams() : bPackedPositions(false) {  }
 
     // Tet mesh vertex positions
     FShaderResourceViewRHIRef TetMeshVertexPosBufferSRV;
 
+    // Packed tet mesh vertex positions and the bounds of each sub-mesh to decode them, read instead of the above when bPackedPositions is set
+    FShaderResourceViewRHIRef TetMeshVertexPackedPosBufferSRV;
+    FShaderResourceViewRHIRef TetMeshPositionBoundsBufferSRV;
+    bool bPackedPositions;
+
     // Tet mesh vertex rotations
     FShaderResourceViewRHIRef TetMeshVertexRotBufferSRV;
 
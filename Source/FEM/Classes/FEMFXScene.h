@@ -10,11 +10,29 @@
 #include "FEMFXMeshComponent.h"
 #include "UObject/UnrealType.h"
 #include "FEMCommon.h"
+#include "AMD_FEMFX.h"
 #include "FEMFXScene.generated.h"
 
 class AFEMFXRigidBodyScene;
 class AFEMActor;
 
+/** Serialized scene state plus the components owning each serialized tet mesh buffer, in buffer id order */
+struct FFEMSceneSnapshot
+{
+	int32 Id = INDEX_NONE;
+	TArray<uint8> Data;
+	TArray<TWeakObjectPtr<UFEMFXMeshComponent>> BufferOwners;
+	int32 NumRigidBodies = 0;
+};
+
+/** Bounds and sampled vertex state of a tet mesh when last read, and how many reads in a row they have not changed */
+struct FFEMTetMeshMotion
+{
+	FBox Bounds = FBox(ForceInit);
+	FVector Sample = FVector::ZeroVector;
+	int32 StillReads = 0;
+};
+
 UCLASS(BlueprintType, Blueprintable, config = Engine, meta = (ShortTooltip = "FEMScene is required to create FEM Meshes. Manages the Buffer data."))
 class AFEMFXScene : public AActor
 {
@@ -73,15 +91,44 @@ class AFEMFXScene : public AActor
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters")
 	int32 MaxJacobianSubmats;
 	
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup Parameters")
+	/** Threads of the shared FEM task system, picked from the CPU topology and the [FEM] engine config section when the scene is created */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Setup Parameters")
 	int32 NumWorkerThreads;
 
+	/** The first time a scene is created on a machine, run CalibrateWorkerThreads. Adds up to a second or two to that scene's creation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters")
+	bool bCalibrateWorkerThreads;
+
+	/** CPU power drawn regardless of how many cores are busy, in units of one busy core. Higher values let the calibration pick more threads */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters", meta = (ClampMin = "0.0", editcondition = "bCalibrateWorkerThreads"))
+	float CalibrationBasePower;
+
+	/** Size the scene from the FEM actors in the level that use it. The Max values above are replaced with the result when the scene is created */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters")
+	bool bAutoSizeCapacities;
+
+	/** Fraction added on top of the capacities found by the sizing pass, to leave room for meshes added at runtime */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters", meta = (ClampMin = "0.0", editcondition = "bAutoSizeCapacities"))
+	float CapacityHeadroom;
+
+	/** Recreate the scene with larger capacities when a mesh or rigid body does not fit or a scene limit is hit during an update, instead of dropping the object */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters")
+	bool bGrowOnOverflow;
+
+	/** Factor applied to a capacity that has run out when the scene grows */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup Parameters", meta = (ClampMin = "1.1", editcondition = "bGrowOnOverflow"))
+	float GrowthFactor;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	FString Name;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	bool bAllowTick;
 
+	/** Run the scene step on the task system overlapped with the rest of the frame. Results are consumed on the next Tick, so rendering and events are one frame behind. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
+	bool bAsyncUpdate;
+
 	/** BEGIN AACTOR INTERFACE */
 	virtual void Destroyed();
 
@@ -104,14 +151,21 @@ class AFEMFXScene : public AActor
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	TArray<UFEMFXMeshComponent*> m_ComponentsAllocated;
 
+	/** Returns the scene, first waiting for any asynchronous step in flight so the caller can safely read or modify it. */
 	AMD::FmScene* GetSceneBuffer();
 
+	/** Blocks until an asynchronous step started by Tick has finished. Its results are still consumed on the next Tick. */
+	UFUNCTION(BlueprintCallable, Category = "FEM")
+	void WaitForAsyncUpdate();
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	AFEMFXRigidBodyScene* RigidBodyScene;
 
     //UFUNCTION(BlueprintCallable, Category = "FEM")
     void AddRigidBodyToScene(AMD::FmRigidBody* inRigidBody);
 
+    void RemoveRigidBodyFromScene(AMD::FmRigidBody* inRigidBody);
+
 	UFUNCTION(BlueprintCallable, Category = "FEM")
 	void AddToResetList(AActor* actor);
 
@@ -121,8 +175,17 @@ class AFEMFXScene : public AActor
 	UFUNCTION(BlueprintCallable, Category = "FEM")
 	void RemoveActor(AFEMActor* actor);
 
+	/** Maximum number of simulation steps run in one frame; time beyond that is dropped to avoid a feedback loop */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	float MaxSteps;
+
+	/** Fixed simulation rate in steps per second, independent of the frame rate */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM", meta = (ClampMin = "10.0", ClampMax = "240.0"))
+	float SimulationRate;
+
+	/** Blend rendered positions between the last two steps so motion stays smooth when the frame rate is above the simulation rate */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
+	bool bInterpolateRendering;
 	
 	void FreeComponent(UFEMFXMeshComponent* comp);
 
@@ -135,9 +198,56 @@ class AFEMFXScene : public AActor
     UFUNCTION(BlueprintCallable, Category = "FEM")
     void SetGroupsCanCollide(int32 i, int32 j, bool canCollide);
 
+	/** Give the shared FEM task system more or fewer threads, up to NumWorkerThreads. Affects every scene. 0 returns to the configured count */
+	UFUNCTION(BlueprintCallable, Category = "FEM")
+	void SetActiveWorkerThreads(int32 NumThreads);
+
+	UFUNCTION(BlueprintPure, Category = "FEM")
+	int32 GetActiveWorkerThreads() const;
+
+	/**
+	 * Step a procedural block at several active thread counts and keep the one with the lowest estimated CPU energy per step,
+	 * step time times (CalibrationBasePower + threads). The result is saved per machine and used by every scene from then on.
+	 * Returns the count picked, 0 if the task system can't change its active thread count.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "FEM")
+	int32 CalibrateWorkerThreads();
+
+    /** Restores the snapshot taken before the first step, see bCaptureInitialSnapshot */
     UFUNCTION(BlueprintNativeEvent, CallInEditor, BlueprintCallable, Category = "FEM")
 	void ResetScene();
 
+	/** Number of snapshots kept by CaptureSnapshot, the oldest is overwritten once all are used */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMSnapshot", meta = (ClampMin = "0"))
+	int32 SnapshotCapacity;
+
+	/**
+	 * Bytes reserved for each snapshot. 0 sizes them from the first capture; they are only reallocated if the scene outgrows them.
+	 * FEMFX can't serialize into caller-owned memory, so every capture still makes one temporary allocation the size of the scene,
+	 * copied into the slot and freed again.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMSnapshot", meta = (ClampMin = "0"))
+	int32 SnapshotSlotBytes;
+
+	/** Capture the loaded state before the first step so ResetScene can return to it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMSnapshot")
+	bool bCaptureInitialSnapshot;
+
+	/** Save the state of every mesh, rigid body and constraint in the scene. Returns the snapshot id, or -1 on failure */
+	UFUNCTION(BlueprintCallable, Category = "FEMSnapshot")
+	int32 CaptureSnapshot();
+
+	/** Return the scene to a snapshot still held. Fails if meshes or rigid bodies were added or removed since it was taken */
+	UFUNCTION(BlueprintCallable, Category = "FEMSnapshot")
+	bool RestoreSnapshot(int32 SnapshotId);
+
+	/** Ids of the snapshots held, oldest first */
+	UFUNCTION(BlueprintPure, Category = "FEMSnapshot")
+	TArray<int32> GetSnapshotIds() const;
+
+	UFUNCTION(BlueprintCallable, Category = "FEMSnapshot")
+	void ClearSnapshots();
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEM")
 	FVector minPlaneConstraint;
 
@@ -159,6 +269,42 @@ class AFEMFXScene : public AActor
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMCollision")
 	float MinContactRelativeVelocity;
 
+	/** Adjust steps per frame and solver iterations at runtime to keep the scene update within BudgetMilliseconds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget")
+	bool bEnableBudgetGovernor;
+
+	/** Target wall time for all scene updates in one frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget", meta = (ClampMin = "0.1"))
+	float BudgetMilliseconds;
+
+	/** The governor never runs fewer steps per frame than this when time is due */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget", meta = (ClampMin = "1"))
+	int32 MinStepsFloor;
+
+	/** Lowest fraction of the authored solver iteration counts the governor may use */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget", meta = (ClampMin = "0.05", ClampMax = "1.0"))
+	float MinSolveQualityScale;
+
+	/** Floor for FmTetMaterialParams::maxUnconstrainedSolveIterations */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget", meta = (ClampMin = "1"))
+	int32 MinUnconstrainedSolveIterations;
+
+	/** Floor for the constraint solve and stabilization iteration counts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "FEMBudget", meta = (ClampMin = "1"))
+	int32 MinConstraintSolveIterations;
+
+	/** Smoothed wall time of the scene updates run per frame */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FEMBudget")
+	float BudgetUpdateMilliseconds;
+
+	/** Current fraction of the authored solver iteration counts, 1 when running at full quality */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FEMBudget")
+	float BudgetSolveQualityScale;
+
+	/** Current step limit chosen by the governor, at most MaxSteps */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FEMBudget")
+	int32 BudgetMaxSteps;
+
 
 	/*bool IsProcessed(FString name);*/
 
@@ -184,11 +330,85 @@ private:
 	AMD::FmScene* AMDFXSceneBuffer;
 
 	/** Brought Over from Eric's FEMFXScene Actor */
-	float frameTime;
 	float timeElapsed;
     float lastTimestep;
 
 	unsigned int maxTriangles;
+
+	/** Asynchronous step state, only touched on the game thread apart from the event trigger */
+	AMD::FmSyncEvent* AsyncUpdateEvent;
+	bool bAsyncUpdateInFlight;
+
+	/** Lookup from tet mesh buffer id to the component owning it, kept in sync by AllocateNewMesh and FreeComponent */
+	TMap<uint32, UFEMFXMeshComponent*> ComponentsByBufferId;
+
+	/** Contacts gathered per component during DispatchCollisionEvents, kept between frames to reuse allocations */
+	TMap<UFEMFXMeshComponent*, TArray<FEMCollision>> PendingCollisions;
+	TArray<UFEMFXMeshComponent*> CollidingComponents;
+
+	static void PostAsyncSceneUpdate(void* TaskData, int32_t TaskBeginIndex, int32_t TaskEndIndex);
+	/** Starts a step in the background, expected to be waited on by the next Tick in ExpectedWaitSeconds */
+	void StartAsyncUpdate(float Timestep, float ExpectedWaitSeconds);
+	void FinishSceneStep();
+	void DispatchCollisionEvents();
+	void CaptureStepStartPositions();
+	void UpdateRenderInterpolation(float Alpha);
+
+	/** Motion signal of every enabled tet mesh when last read, by object id */
+	TMap<uint32, FFEMTetMeshMotion> TetMeshMotion;
+	TSet<UFEMFXMeshComponent*> ChangedComponents;
+
+	/** Components handed to the parallel render data passes, kept between frames to reuse the allocation */
+	TArray<UFEMFXMeshComponent*> ParallelComponents;
+
+	void GatherChangedComponents();
+
+	/** Budget governor state; the authored solver iterations are captured when the scene is created */
+	AMD::FmSceneControlParams AuthoredControlParams;
+	double AsyncUpdateStartTime;
+	double AsyncUpdateEndTime;
+	double FrameUpdateSeconds;
+	float BudgetNextAdjustTime;
+	float AppliedSolveQualityScale;
+
+	void UpdateBudgetGovernor(float DeltaTime);
+	void ApplySolveQualityScale();
+
+	/** Tet mesh buffer feature limit and solver memory the scene is created with, set by ComputeAutoCapacities when auto sizing */
+	int32 MaxTetMeshBufferFeatures;
+	size_t MaxConstraintSolverDataSize;
+
+	void ComputeAutoCapacities();
+	AMD::FmSceneSetupParams MakeSceneSetupParams() const;
+
+	/** Rigid bodies added through AddRigidBodyToScene, needed to match them up with their copies when the scene is recreated */
+	TArray<AMD::FmRigidBody*> SceneRigidBodies;
+
+	/** Scene limit warnings seen since the last Tick, see FM_WARNING_FLAG_HIT_LIMIT_SCENE_* */
+	uint32 PendingGrowFlags;
+
+	void GrowForWarnings(uint32 WarningFlags);
+	bool RecreateScene();
+
+	void GetSerializedObjectOwners(TArray<UFEMFXMeshComponent*>& OutBufferOwners, TArray<AMD::FmRigidBody*>& OutRigidBodies);
+	bool DeserializeScene(AMD::FmScene* TargetScene, const uint8_t* Serialized, int32 NumBufferOwners, int32 NumRigidBodies,
+		TArray<AMD::FmTetMeshBuffer*>& OutBuffers, TArray<AMD::FmRigidBody*>& OutRigidBodies);
+	void RebindDeserializedObjects(const TArray<UFEMFXMeshComponent*>& BufferOwners, const TArray<AMD::FmTetMeshBuffer*>& NewBuffers,
+		const TArray<AMD::FmRigidBody*>& OldRigidBodies, const TArray<AMD::FmRigidBody*>& NewRigidBodies);
+
+	/** Snapshot ring, slot Id % SnapshotCapacity holds snapshot Id. The initial snapshot is kept apart so the ring never overwrites it */
+	TArray<FFEMSceneSnapshot> Snapshots;
+	FFEMSceneSnapshot InitialSnapshot;
+	int32 NextSnapshotId;
+	bool bInitialSnapshotPending;
+
+	/** Scratch lists for matching serialized objects, kept to avoid allocating on every capture */
+	TArray<UFEMFXMeshComponent*> SnapshotBufferOwners;
+	TArray<AMD::FmRigidBody*> SnapshotRigidBodies;
+	TArray<uint32> SnapshotBufferIds;
+
+	bool WriteSnapshot(FFEMSceneSnapshot& Snapshot);
+	bool ReadSnapshot(const FFEMSceneSnapshot& Snapshot);
 	
 	void FreeScene();
 	/*void UpdateDebugTetMesh();*/
@@ -136,7 +136,7 @@ public:
 
 	FORCEINLINE FBoxSphereBounds GetLocalBounds() const { return LocalBounds; }
 
-	FORCEINLINE FComponentResources GetComponentResource() const { return ComponentResources; }
+	FORCEINLINE const FComponentResources& GetComponentResource() const { return ComponentResources; }
 
 	FORCEINLINE int32 GetNumberOfCornersPerShard() const { return NumberOfCornersPerShard; }
 
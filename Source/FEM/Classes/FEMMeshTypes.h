@@ -106,6 +106,33 @@ struct FFEMFXMeshTetRotation
 		FVector Col2;
 };
 
+// Tet mesh vertex rotation as uploaded to the GPU: a unit quaternion in Unreal space with each component stored as a
+// signed normalized 16 bit value. The vertex factory rebuilds the matrix, see UnpackFEMFXRotation for the CPU equivalent.
+struct FFEMFXMeshPackedRotation
+{
+	int16 X;
+	int16 Y;
+	int16 Z;
+	int16 W;
+};
+
+// Tet mesh vertex position as uploaded to the GPU when UFEMFXMeshComponent::bPackRenderPositions is set: 16 bit fixed point
+// within the current bounds of the vertex's sub-mesh. The padding slot holds the sub-mesh index, which selects the bounds.
+struct FFEMFXMeshPackedPosition
+{
+	uint16 X;
+	uint16 Y;
+	uint16 Z;
+	uint16 SubMeshIndex;
+};
+
+// Decodes the packed positions of one sub-mesh as Min + Packed * Step, W unused
+struct FFEMFXMeshPositionBounds
+{
+	FVector4 Min;
+	FVector4 Step;
+};
+
 /**
 *	Struct used to specify a tangent vector for a vertex
 *	The Y tangent is computed from the cross product of the vertex normal (Tangent Z) and the TangentX member.
@@ -432,7 +459,7 @@ public:
 struct FFEMTetMeshRenderData
 {
 	TArray<FVector> FEMMeshVertexPositions;
-	TArray<FFEMFXMeshTetRotation> FEMMeshVertexRotations;
+	TArray<FFEMFXMeshPackedRotation> FEMMeshVertexRotations;
 	TArray<FFEMFXMeshTetVertexIds> FEMMeshTetVertexIds;
 	TArray<float> FEMMeshDeformations;
 };
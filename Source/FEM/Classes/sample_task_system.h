@@ -22,17 +22,76 @@ namespace AMD
     int SampleGetTaskSystemNumThreads();
     int SampleGetTaskSystemDefaultNumThreads();
 
+    // Number of threads taking work, at most SampleGetTaskSystemNumThreads() which stays fixed because scenes
+    // allocate per-thread memory from it. Can be changed at any time, backends that can't resize ignore it.
+    void SampleSetTaskSystemNumActiveThreads(int numThreads);
+    int SampleGetTaskSystemNumActiveThreads();
+
     void SampleWaitForAllThreadsToStart();
 
     // Return index of current worker thread, between 0 and numThreads-1, unique between workers running concurrently
     int SampleGetTaskSystemWorkerIndex();
 
+    // Use of the fixed pools task records and sync events are allocated from. Overflows fell back to the heap.
+    struct SampleTaskSystemPoolStats
+    {
+        int32_t numTasksInUse;
+        int32_t peakTasksInUse;
+        int32_t taskCapacity;
+        int32_t numTaskOverflows;
+
+        int32_t numEventsInUse;
+        int32_t peakEventsInUse;
+        int32_t eventCapacity;
+        int32_t numEventOverflows;
+    };
+
+    void SampleGetTaskSystemPoolStats(SampleTaskSystemPoolStats& outStats);
+
+    // Called on each worker thread as it starts, before it runs any task, with the worker's index.
+    // Lets the application set affinity and priority with its own platform layer. Set before SampleInitTaskSystem().
+    typedef void(*SampleWorkerStartCallback)(int workerIndex);
+    void SampleSetTaskSystemWorkerStartCallback(SampleWorkerStartCallback callback);
+
+    // Monotonic clock used for task deadlines and timings
+    uint64_t SampleGetTaskSystemTimeNs();
+
+    // Task timing capture, off by default. Each enable starts a new capture of every task's name, worker, start and end.
+    void SampleSetTaskSystemTracing(bool enable);
+    bool SampleGetTaskSystemTracing();
+
+    // Write the current capture as Chrome trace event JSON, for chrome://tracing or Perfetto
+    bool SampleWriteTaskSystemChromeTrace(const char* path);
+
+    // Called around each task on the thread running it while tracing is on, e.g. to emit profiler scopes
+    typedef void(*SampleTaskScopeBeginCallback)(const char* taskName);
+    typedef void(*SampleTaskScopeEndCallback)();
+    void SampleSetTaskSystemScopeCallbacks(SampleTaskScopeBeginCallback begin, SampleTaskScopeEndCallback end);
+
 #if SAMPLE_ASYNC_THREADING
     typedef void FmSyncEvent;
 
     // Submit asynchronous task to task scheduler, which should run TaskFunc, taskData and taskIndex arguments
     void SampleAsyncTask(const char* taskName, FmTaskFuncCallback TaskFunc, void *taskData, int32_t taskBeginIndex, int32_t taskEndIndex);
 
+    // Classes workers take tasks in, highest first
+    enum SampleTaskPriority
+    {
+        SAMPLE_TASK_PRIORITY_CRITICAL,      // Gates completion of work something is blocked on, e.g. a step the game thread waits for
+        SAMPLE_TASK_PRIORITY_NORMAL,
+        SAMPLE_TASK_PRIORITY_BACKGROUND,    // Only runs when no other FEM work is queued
+        SAMPLE_TASK_PRIORITY_COUNT
+    };
+
+    // Submit with an explicit class and an optional deadline in SampleGetTaskSystemTimeNs() time, 0 for none.
+    // Tasks it submits through SampleAsyncTask() inherit both. Work submitted or taken by a worker close to its deadline runs as critical.
+    void SampleAsyncTaskWithPriority(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex,
+        SampleTaskPriority priority, uint64_t deadlineNs);
+
+    // Class and deadline for tasks the calling thread submits through SampleAsyncTask() outside of a task, e.g. around FmUpdateScene()
+    void SampleSetThreadTaskPriority(SampleTaskPriority priority, uint64_t deadlineNs);
+    void SampleGetThreadTaskPriority(SampleTaskPriority& outPriority, uint64_t& outDeadlineNs);
+
     // Create task event
     FmSyncEvent* SampleCreateSyncEvent();
 
@@ -44,6 +44,7 @@ public class FEM : ModuleRules
 		string FEMLibPath = Path.Combine(FEMFXDir, "lib");
 
 		PublicAdditionalLibraries.Add(Path.Combine(FEMLibPath, "AMD_FEMFX.lib"));
-		PublicAdditionalLibraries.Add(Path.Combine(FEMLibPath, "sample_task_system.lib"));
+
+		// The task system callbacks come from the native backend in sample_task_system.cpp, not the prebuilt sample_task_system.lib
 	}
 }
@@ -2,18 +2,345 @@
 
 #include "FEM.h"
 #include "Interfaces/IPluginManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformAffinity.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "sample_task_system.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#elif PLATFORM_UNIX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 DEFINE_LOG_CATEGORY(FEMLog);
 
+// Applied by every FEM worker thread as it starts
+static uint64 GFEMWorkerAffinityMask = 0;
+static EThreadPriority GFEMWorkerPriority = TPri_BelowNormal;
+
+static void ConfigureFEMWorkerThread(int WorkerIndex)
+{
+	if (GFEMWorkerAffinityMask != 0)
+	{
+		FPlatformProcess::SetThreadAffinityMask(GFEMWorkerAffinityMask);
+	}
+
+#if PLATFORM_WINDOWS
+	int Priority = THREAD_PRIORITY_NORMAL;
+	switch (GFEMWorkerPriority)
+	{
+	case TPri_Lowest:		Priority = THREAD_PRIORITY_LOWEST; break;
+	case TPri_BelowNormal:	Priority = THREAD_PRIORITY_BELOW_NORMAL; break;
+	case TPri_AboveNormal:	Priority = THREAD_PRIORITY_ABOVE_NORMAL; break;
+	default: break;
+	}
+	::SetThreadPriority(::GetCurrentThread(), Priority);
+#elif PLATFORM_UNIX
+	// Nice values are per thread on Linux
+	int Nice = 0;
+	switch (GFEMWorkerPriority)
+	{
+	case TPri_Lowest:		Nice = 10; break;
+	case TPri_BelowNormal:	Nice = 5; break;
+	default: break;
+	}
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), Nice);
+#endif
+}
+
+static EThreadPriority ParseWorkerPriority(const FString& Priority)
+{
+	if (Priority == TEXT("Lowest"))			return TPri_Lowest;
+	if (Priority == TEXT("Normal"))			return TPri_Normal;
+	if (Priority == TEXT("AboveNormal"))	return TPri_AboveNormal;
+	return TPri_BelowNormal;
+}
+
+static int32 GFEMActiveWorkerThreads = 0;
+static FAutoConsoleVariableRef CVarFEMActiveWorkerThreads(
+	TEXT("fem.ActiveWorkerThreads"),
+	GFEMActiveWorkerThreads,
+	TEXT("Number of FEM task system threads taking work, including the game thread. 0 uses the count picked at startup.\n")
+	TEXT("Capped by [FEM] MaxWorkerThreads; changing it parks or wakes threads without recreating anything."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+	{
+		if (FFEMModule* Module = FModuleManager::GetModulePtr<FFEMModule>(TEXT("FEM")))
+		{
+			Module->SetTaskSystemActiveThreads(GFEMActiveWorkerThreads);
+		}
+	}),
+	ECVF_Default);
+
+#if CPUPROFILERTRACE_ENABLED
+static void BeginFEMTaskScope(const char* TaskName)
+{
+	FCpuProfilerTrace::OutputBeginDynamicEvent(TaskName);
+}
+
+static void EndFEMTaskScope()
+{
+	FCpuProfilerTrace::OutputEndEvent();
+}
+#endif
+
+static int32 GFEMTaskTrace = 0;
+static FAutoConsoleVariableRef CVarFEMTaskTrace(
+	TEXT("fem.TaskTrace"),
+	GFEMTaskTrace,
+	TEXT("Record the name, worker and timing of every FEM task. Tasks also show up as CPU scopes in Unreal Insights while on.\n")
+	TEXT("Write the capture with fem.WriteTaskTrace. Turning it on again starts a new capture."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+	{
+		AMD::SampleSetTaskSystemTracing(GFEMTaskTrace != 0);
+	}),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdFEMWriteTaskTrace(
+	TEXT("fem.WriteTaskTrace"),
+	TEXT("Write the FEM task capture as Chrome trace JSON (chrome://tracing, Perfetto). Optional argument: file path, defaults to the profiling directory."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FString Path = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProfilingDir(), FString::Printf(TEXT("FEMTaskTrace-%s.json"), *FDateTime::Now().ToString()));
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+		Path = FPaths::ConvertRelativePathToFull(Path);
+
+		if (AMD::SampleWriteTaskSystemChromeTrace(TCHAR_TO_UTF8(*Path)))
+		{
+			UE_LOG(FEMLog, Display, TEXT("FEM task trace written to %s"), *Path);
+		}
+		else
+		{
+			UE_LOG(FEMLog, Warning, TEXT("Could not write FEM task trace to %s"), *Path);
+		}
+	}));
+
+static const TCHAR* FEMCalibrationSection = TEXT("FEM.Calibration");
+
+/** Identifies the CPU a calibration ran on, so a saved config copied to another machine isn't trusted */
+static FString GetCalibrationMachineKey()
+{
+	return FString::Printf(TEXT("%s/%d"), *FPlatformMisc::GetCPUBrand().TrimStartAndEnd(), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+}
+
+static int32 ReadCalibratedWorkerThreads()
+{
+	FString Machine;
+	int32 NumThreads = 0;
+	if (GConfig->GetString(FEMCalibrationSection, TEXT("Machine"), Machine, GEngineIni) && Machine == GetCalibrationMachineKey())
+	{
+		GConfig->GetInt(FEMCalibrationSection, TEXT("NumWorkerThreads"), NumThreads, GEngineIni);
+	}
+
+	return NumThreads;
+}
+
+/**
+ * Reads the thread counts from the [FEM] engine config section, which platforms override in their own Engine.ini.
+ * Returns the number of threads to run FEM tasks on, counting the game thread which runs them while it waits.
+ * OutMaxThreads is how many to start, the most that can be made active later.
+ */
+static int32 ReadConfiguredWorkerThreads(int32& OutMaxThreads, int32& OutCalibratedThreads)
+{
+	const TCHAR* Section = TEXT("FEM");
+
+	int32 NumThreads = 0;
+	int32 MaxThreads = 0;
+	int32 ReservedCores = 2;
+	int32 CoreClusterSize = 0;
+	bool bUseSMT = false;
+	GConfig->GetInt(Section, TEXT("NumWorkerThreads"), NumThreads, GEngineIni);
+	GConfig->GetInt(Section, TEXT("MaxWorkerThreads"), MaxThreads, GEngineIni);
+	GConfig->GetInt(Section, TEXT("ReservedCores"), ReservedCores, GEngineIni);
+	GConfig->GetInt(Section, TEXT("CoreClusterSize"), CoreClusterSize, GEngineIni);
+	GConfig->GetBool(Section, TEXT("bUseSMT"), bUseSMT, GEngineIni);
+
+	const int32 NumPhysicalCores = FPlatformMisc::NumberOfCores();
+	const int32 NumLogicalCores = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+
+	// An explicit NumWorkerThreads wins over a calibration, which wins over the topology default
+	const int32 CalibratedThreads = NumThreads <= 0 ? ReadCalibratedWorkerThreads() : 0;
+	OutCalibratedThreads = CalibratedThreads;
+	if (CalibratedThreads > 0)
+	{
+		NumThreads = FMath::Clamp(CalibratedThreads, 2, 64);
+	}
+	else if (NumThreads <= 0)
+	{
+		// SMT siblings add little to the solver's throughput, so by default only physical cores count.
+		// ReservedCores are left to the render and RHI threads.
+		NumThreads = (bUseSMT ? NumLogicalCores : NumPhysicalCores) - ReservedCores;
+
+		// Stay within whole core clusters (CCXs) so workers don't share data across the slower cluster interconnect
+		if (CoreClusterSize > 0 && NumThreads > CoreClusterSize)
+		{
+			NumThreads -= NumThreads % CoreClusterSize;
+		}
+
+		NumThreads = FMath::Clamp(NumThreads, 2, 64);
+	}
+
+	// Scenes allocate per-thread memory for all of these, so by default only allow growing up to one thread per core
+	if (MaxThreads <= 0)
+	{
+		MaxThreads = bUseSMT ? NumLogicalCores : NumPhysicalCores;
+	}
+	OutMaxThreads = FMath::Clamp(MaxThreads, NumThreads, 64);
+
+	return NumThreads;
+}
+
+/** ReadConfiguredWorkerThreads, plus setting up worker affinity and priority from the same section before the workers start */
+static int32 ConfigureTaskSystem(int32& OutMaxThreads)
+{
+	const TCHAR* Section = TEXT("FEM");
+
+	FString WorkerPriority = TEXT("BelowNormal");
+	FString WorkerAffinityMask;
+	GConfig->GetString(Section, TEXT("WorkerPriority"), WorkerPriority, GEngineIni);
+	GConfig->GetString(Section, TEXT("WorkerAffinityMask"), WorkerAffinityMask, GEngineIni);
+
+	int32 CalibratedThreads = 0;
+	const int32 NumThreads = ReadConfiguredWorkerThreads(OutMaxThreads, CalibratedThreads);
+
+	const int32 NumPhysicalCores = FPlatformMisc::NumberOfCores();
+	const int32 NumLogicalCores = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+
+	GFEMWorkerPriority = ParseWorkerPriority(WorkerPriority);
+
+	GFEMWorkerAffinityMask = 0;
+	if (!WorkerAffinityMask.IsEmpty())
+	{
+		GFEMWorkerAffinityMask = FCString::Strtoui64(*WorkerAffinityMask, nullptr, 0);
+	}
+	else if (NumLogicalCores < 64)
+	{
+		// Keep off cores the platform dedicates to the render and RHI threads, where it pins them
+		const uint64 AllCores = (1ull << NumLogicalCores) - 1;
+		const uint64 EngineCores = (FPlatformAffinity::GetRenderingThreadMask() | FPlatformAffinity::GetRHIThreadMask()) & AllCores;
+		if (EngineCores != AllCores && (AllCores & ~EngineCores) != 0)
+		{
+			GFEMWorkerAffinityMask = AllCores & ~EngineCores;
+		}
+	}
+
+	AMD::SampleSetTaskSystemWorkerStartCallback(ConfigureFEMWorkerThread);
+
+	UE_LOG(FEMLog, Log, TEXT("FEM task system config: %d physical cores, %d logical, %d of %d threads%s, priority %s, affinity 0x%llx"),
+		NumPhysicalCores, NumLogicalCores, NumThreads, OutMaxThreads, CalibratedThreads > 0 ? TEXT(" (calibrated)") : TEXT(""),
+		*WorkerPriority, GFEMWorkerAffinityMask);
+
+	return NumThreads;
+}
+
 void FFEMModule::StartupModule()
 {
 	const FString PluginDir = IPluginManager::Get().FindPlugin(TEXT("FEM"))->GetBaseDir();
 	const FString PluginShaderDir = FPaths::Combine(PluginDir, TEXT("Shaders"));
 	AddShaderSourceDirectoryMapping(TEXT("/Plugin/FEM"), PluginShaderDir);
+
+#if CPUPROFILERTRACE_ENABLED
+	AMD::SampleSetTaskSystemScopeCallbacks(BeginFEMTaskScope, EndFEMTaskScope);
+#endif
 }
 
 void FFEMModule::ShutdownModule()
 {
+	FScopeLock Lock(&TaskSystemLock);
+
+	if (TaskSystemRefCount > 0)
+	{
+		UE_LOG(FEMLog, Warning, TEXT("FEM task system still has %d users at shutdown"), TaskSystemRefCount);
+		AMD::SampleDestroyTaskSystem();
+		TaskSystemRefCount = 0;
+		TaskSystemNumThreads = 0;
+	}
+}
+
+int32 FFEMModule::AcquireTaskSystem()
+{
+	FScopeLock Lock(&TaskSystemLock);
+
+	if (TaskSystemRefCount++ == 0)
+	{
+		int32 MaxThreads = 0;
+		TaskSystemConfiguredThreads = ConfigureTaskSystem(MaxThreads);
+
+		AMD::SampleInitTaskSystem(MaxThreads);
+		TaskSystemNumThreads = AMD::SampleGetTaskSystemNumThreads();
+		AMD::SampleSetTaskSystemNumActiveThreads(GFEMActiveWorkerThreads > 0 ? GFEMActiveWorkerThreads : TaskSystemConfiguredThreads);
+
+		UE_LOG(FEMLog, Log, TEXT("FEM task system started with %d worker threads"), TaskSystemNumThreads);
+	}
+
+	return TaskSystemNumThreads;
+}
+
+void FFEMModule::ReleaseTaskSystem()
+{
+	FScopeLock Lock(&TaskSystemLock);
+
+	if (!ensure(TaskSystemRefCount > 0))
+	{
+		return;
+	}
+
+	if (--TaskSystemRefCount == 0)
+	{
+		AMD::SampleDestroyTaskSystem();
+		TaskSystemNumThreads = 0;
+	}
+}
+
+void FFEMModule::SetTaskSystemActiveThreads(int32 NumThreads)
+{
+	FScopeLock Lock(&TaskSystemLock);
+
+	if (TaskSystemRefCount == 0)
+	{
+		return;
+	}
+
+	AMD::SampleSetTaskSystemNumActiveThreads(NumThreads > 0 ? NumThreads : TaskSystemConfiguredThreads);
+}
+
+int32 FFEMModule::GetTaskSystemActiveThreads() const
+{
+	return TaskSystemNumThreads > 0 ? AMD::SampleGetTaskSystemNumActiveThreads() : 0;
+}
+
+int32 FFEMModule::GetCalibratedWorkerThreads() const
+{
+	return ReadCalibratedWorkerThreads();
+}
+
+void FFEMModule::SetCalibratedWorkerThreads(int32 NumThreads)
+{
+	GConfig->SetString(FEMCalibrationSection, TEXT("Machine"), *GetCalibrationMachineKey(), GEngineIni);
+	GConfig->SetInt(FEMCalibrationSection, TEXT("NumWorkerThreads"), NumThreads, GEngineIni);
+	GConfig->Flush(false, GEngineIni);
+
+	{
+		FScopeLock Lock(&TaskSystemLock);
+
+		// Only the count changes, the running workers keep the priority and affinity they were started with
+		if (TaskSystemRefCount > 0)
+		{
+			int32 MaxThreads = 0;
+			int32 CalibratedThreads = 0;
+			TaskSystemConfiguredThreads = ReadConfiguredWorkerThreads(MaxThreads, CalibratedThreads);
+		}
+	}
+
+	// Back to the configured count, which is now the calibrated one unless fem.ActiveWorkerThreads overrides it
+	SetTaskSystemActiveThreads(GFEMActiveWorkerThreads);
 }
 
 IMPLEMENT_MODULE(FFEMModule, FEM)
@@ -44,7 +44,7 @@ void AFEMActor::Destroyed()
 	}
 	for (int32 i = 0; i < rigidBodies.Num(); ++i)
 	{
-		AMD::FmRemoveRigidBodyFromScene(Scene->GetSceneBuffer(), FmGetObjectId(*rigidBodies[i]));
+		Scene->RemoveRigidBodyFromScene(rigidBodies[i]);
         AMD::FmDestroyRigidBody(rigidBodies[i]);
 	}
 	rigidBodies.Empty();
@@ -680,3 +680,18 @@ void AFEMActor::AddObjectIds(TArray<uint32>& TetMeshIds, TArray<uint32>& RigidBo
         }
     }
 }
+
+void AFEMActor::RebindSceneObjects(const TMap<AMD::FmRigidBody*, AMD::FmRigidBody*>& RigidBodyMap)
+{
+    for (int i = 0; i < rigidBodies.Num(); ++i)
+    {
+        AMD::FmRigidBody* const* NewRigidBody = RigidBodyMap.Find(rigidBodies[i]);
+        if (NewRigidBody)
+        {
+            AMD::FmDestroyRigidBody(rigidBodies[i]);
+            rigidBodies[i] = *NewRigidBody;
+        }
+    }
+
+    CreateIdMapping();
+}
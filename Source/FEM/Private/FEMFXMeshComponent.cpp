@@ -66,6 +66,8 @@ static void ConvertFEMFXMeshToDynMeshVertex(FFEMFXMeshRenderVertex& Vert, const
 FFEMFXMeshSceneProxy::FFEMFXMeshSceneProxy(UFEMFXMeshComponent* Component)
         : FPrimitiveSceneProxy(Component)
         //, BodySetup(Component->GetBodySetup())
+        , bPackedPositions(false)
+        , NextStagingSlot(0)
         , MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
 {
     // Copy each section
@@ -127,7 +129,14 @@ FFEMFXMeshSceneProxy::FFEMFXMeshSceneProxy(UFEMFXMeshComponent* Component)
 
 		TetVertexIds.Init(Component->FEMMesh->GetTetMesh()->GetTetVertexIds());
 		TetMeshVertexPositions.Init(Component->FEMMesh->GetTetMesh()->GetVertexPositions());
-		TetMeshVertexRotations.Init(Component->FEMMesh->GetTetMesh()->GetVertexRotations());
+
+		// Placeholders until the first packed update, so every position parameter has a resource bound
+		TetMeshVertexPackedPositions.Init(1);
+		TetMeshPositionBounds.Init(1);
+
+		TArray<FFEMFXMeshPackedRotation> PackedRotations;
+		PackFEMFXRotations(PackedRotations, Component->FEMMesh->GetTetMesh()->GetVertexRotations());
+		TetMeshVertexRotations.Init(PackedRotations);
 		TetMeshDeformations.Init(Component->FEMMesh->GetTetMesh()->GetDeformations());
 	}
 }
@@ -148,7 +157,7 @@ FFEMFXMeshSceneProxy::~FFEMFXMeshSceneProxy()
 
 void FFEMFXMeshSceneProxy::UpdateRenderData(
 	const TArray<FVector>& NewVertexPositions,
-	const TArray<FFEMFXMeshTetRotation>& NewVertexRotations,
+	const TArray<FFEMFXMeshPackedRotation>& NewVertexRotations,
 	const TArray<FFEMFXMeshTetVertexIds>& NewTetVertexIds,
 	const TArray<float>& NewDeformations,
 	bool PadVerticesForFracture)
@@ -294,14 +303,36 @@ void FFEMFXMeshSceneProxy::UpdateSection(int32 SectionIdx, const TArray<FFEMFXMe
     }
 }
 
-void FFEMFXMeshSceneProxy::UpdateTetMesh(const FFEMTetMeshRenderData RenderData, bool PadVerticesForFracture)
+void FFEMFXMeshSceneProxy::UpdateTetMesh(const FFEMTetMeshRenderData& RenderData, bool PadVerticesForFracture)
 {
 	UpdateTetMesh(RenderData.FEMMeshVertexPositions, RenderData.FEMMeshVertexRotations, RenderData.FEMMeshDeformations, PadVerticesForFracture);
 	UpdateTetVertexIds(RenderData.FEMMeshTetVertexIds);
 }
 
+/** Writes NewElements to Buffer, growing it first if needed, with room to spare when padding for fracture */
+template<class Element>
+static void UpdateTetMeshBuffer(FStructuredBufferAndSRV<Element>& Buffer, const TArray<Element>& NewElements, bool PadVerticesForFracture)
+{
+    if (NewElements.Num() > Buffer.NumElements)
+    {
+        if (PadVerticesForFracture)
+        {
+            Buffer.Init(NewElements.Num() * 2);
+            Buffer.Update(NewElements);
+        }
+        else
+        {
+            Buffer.Init(NewElements);
+        }
+    }
+    else
+    {
+        Buffer.Update(NewElements);
+    }
+}
+
    /** Called on render thread to assign new dynamic data */
-void FFEMFXMeshSceneProxy::UpdateTetMesh(const TArray<FVector>& NewVertexPositions, const TArray<FFEMFXMeshTetRotation>& NewVertexRotations,
+void FFEMFXMeshSceneProxy::UpdateTetMesh(const TArray<FVector>& NewVertexPositions, const TArray<FFEMFXMeshPackedRotation>& NewVertexRotations,
      const TArray<float>& NewDeformations, bool PadVerticesForFracture)
 {
     //SCOPE_CYCLE_COUNTER(STAT_FEMFXMesh_UpdateSectionRT);
@@ -312,31 +343,88 @@ void FFEMFXMeshSceneProxy::UpdateTetMesh(const TArray<FVector>& NewVertexPositio
         return;
     }
 
-    if (NewVertexPositions.Num() > TetMeshVertexPositions.NumElements)
+    UpdateTetMeshBuffer(TetMeshVertexPositions, NewVertexPositions, PadVerticesForFracture);
+    UpdateTetMeshBuffer(TetMeshVertexRotations, NewVertexRotations, PadVerticesForFracture);
+    UpdateTetMeshBuffer(TetMeshDeformations, NewDeformations, PadVerticesForFracture);
+    SetPackedPositions(false);
+}
+
+FFEMFXMeshStagingSlot* FFEMFXMeshSceneProxy::BeginStagingSlot()
+{
+    // Slots are uploaded in submission order, so only the oldest one can still be in flight
+    FFEMFXMeshStagingSlot* Slot = &StagingSlots[NextStagingSlot];
+    if (Slot->bInFlight)
+    {
+        return nullptr;
+    }
+
+    NextStagingSlot = (NextStagingSlot + 1) % NumStagingSlots;
+
+    Slot->Positions.Reset();
+    Slot->PackedPositions.Reset();
+    Slot->PositionBounds.Reset();
+    Slot->Rotations.Reset();
+    Slot->Deformations.Reset();
+    Slot->TetVertexIds.Reset();
+    Slot->bPackedPositions = false;
+    return Slot;
+}
+
+void FFEMFXMeshSceneProxy::SubmitStagingSlot(FFEMFXMeshStagingSlot* Slot, bool PadVerticesForFracture)
+{
+    Slot->bInFlight = true;
+
+    ENQUEUE_RENDER_COMMAND(UploadFEMFXMeshStagingSlot)([this, Slot, PadVerticesForFracture](FRHICommandListImmediate& RHICmdList)
     {
-        if (PadVerticesForFracture)
-        {
-            TetMeshVertexPositions.Init(NewVertexPositions.Num() * 2);
-            TetMeshVertexPositions.Update(NewVertexPositions);
+        this->UploadStagingSlot_RenderThread(Slot, PadVerticesForFracture);
+    });
+}
 
-            TetMeshVertexRotations.Init(NewVertexRotations.Num() * 2);
-            TetMeshVertexRotations.Update(NewVertexRotations);
+/** Locks each buffer the slot has data for and copies the slot's array into it, the only copy the data makes on this side */
+void FFEMFXMeshSceneProxy::UploadStagingSlot_RenderThread(FFEMFXMeshStagingSlot* Slot, bool PadVerticesForFracture)
+{
+    check(IsInRenderingThread());
 
-			TetMeshDeformations.Init(NewDeformations.Num() * 2);
-			TetMeshDeformations.Update(NewDeformations);
-        }
-        else
-        {
-            TetMeshVertexPositions.Init(NewVertexPositions);
-            TetMeshVertexRotations.Init(NewVertexRotations);
-			TetMeshDeformations.Init(NewDeformations);
-        }
+    if (Slot->bPackedPositions)
+    {
+        UpdateTetMeshBuffer(TetMeshVertexPackedPositions, Slot->PackedPositions, PadVerticesForFracture);
+        UpdateTetMeshBuffer(TetMeshPositionBounds, Slot->PositionBounds, PadVerticesForFracture);
+    }
+    else if (Slot->Positions.Num() > 0)
+    {
+        UpdateTetMeshBuffer(TetMeshVertexPositions, Slot->Positions, PadVerticesForFracture);
+    }
+    bPackedPositions = Slot->bPackedPositions;
+
+    if (Slot->Rotations.Num() > 0)
+    {
+        UpdateTetMeshBuffer(TetMeshVertexRotations, Slot->Rotations, PadVerticesForFracture);
+    }
+    if (Slot->Deformations.Num() > 0)
+    {
+        UpdateTetMeshBuffer(TetMeshDeformations, Slot->Deformations, PadVerticesForFracture);
+    }
+    if (Slot->TetVertexIds.Num() > 0)
+    {
+        UpdateTetMeshBuffer(TetVertexIds, Slot->TetVertexIds, false);
+    }
+
+    Slot->bInFlight = false;
+}
+
+/** Switches the position stream read by the shader, ordered after the buffer updates enqueued before it */
+void FFEMFXMeshSceneProxy::SetPackedPositions(bool bPacked)
+{
+    if (IsInRenderingThread())
+    {
+        bPackedPositions = bPacked;
     }
     else
     {
-        TetMeshVertexPositions.Update(NewVertexPositions);
-        TetMeshVertexRotations.Update(NewVertexRotations);
-		TetMeshDeformations.Update(NewDeformations);
+        ENQUEUE_RENDER_COMMAND(SetFEMFXPackedPositions)([this, bPacked](FRHICommandListImmediate& RHICmdList)
+        {
+            this->bPackedPositions = bPacked;
+        });
     }
 }
 
@@ -406,6 +494,9 @@ void FFEMFXMeshSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*
                     // Set SRV references in user data
                     FFEMFXMeshBatchElementParams* BatchElementParams = new FFEMFXMeshBatchElementParams;
                     BatchElementParams->TetMeshVertexPosBufferSRV = TetMeshVertexPositions.SRV;
+                    BatchElementParams->TetMeshVertexPackedPosBufferSRV = TetMeshVertexPackedPositions.SRV;
+                    BatchElementParams->TetMeshPositionBoundsBufferSRV = TetMeshPositionBounds.SRV;
+                    BatchElementParams->bPackedPositions = bPackedPositions;
                     BatchElementParams->TetMeshVertexRotBufferSRV = TetMeshVertexRotations.SRV;
                     BatchElementParams->TetMeshDeformationBufferSRV = TetMeshDeformations.SRV;
                     BatchElementParams->TetVertexIdBufferSRV = TetVertexIds.SRV;
@@ -523,6 +614,23 @@ UFEMFXMeshComponent::UFEMFXMeshComponent(const FObjectInitializer& ObjectInitial
 
     TetAssignmentsNeedUpdate = true;
 
+    SimBounds.Init();
+    PreviousSimBounds.Init();
+    StepStartBounds.Init();
+    bHasStepStartPositions = false;
+    bSimStateUnchanged = false;
+    bUnchangedStateUploaded = false;
+
+    AppliedSolveIterations = -1;
+    bPackRenderPositions = false;
+
+    TopologyGeneration = 1;
+    CapturedTopologyGeneration = 0;
+    CapturedTopologyNumSubMeshes = 0;
+    UploadedTopologyGeneration = 0;
+    CapturedStateGeneration = 0;
+    UploadedStateGeneration = 0;
+
 	EditorOnly = false;
 }
 
@@ -534,6 +642,7 @@ unsigned int UFEMFXMeshComponent::GetBufferId()
 
 void UFEMFXMeshComponent::SetTetMaterial_NoFracture(UFEMFXTetMeshParameters* newParameters, int TetId, int NoFractureFaces)
 {
+	WaitForSceneUpdate();
 
 	UFEMFXTetMeshParameters* temp = newParameters;// .GetDefaultObject();
 
@@ -564,6 +673,7 @@ void UFEMFXMeshComponent::SetTetMaterial_NoFracture(UFEMFXTetMeshParameters* new
 
 void UFEMFXMeshComponent::SetTetMaterial(UFEMFXTetMeshParameters* newParameters, int TetId)
 {
+	WaitForSceneUpdate();
 
 	UFEMFXTetMeshParameters* temp = newParameters;// .GetDefaultObject();
 
@@ -593,6 +703,8 @@ void UFEMFXMeshComponent::SetTetMaterial(UFEMFXTetMeshParameters* newParameters,
 
 void UFEMFXMeshComponent::SetTetMeshMaterial(UFEMFXTetMeshParameters* newParameters, float plasticAttenuation)
 {
+	WaitForSceneUpdate();
+
 	if (GetTetMeshBuffer() == nullptr)
 	{
 		return;
@@ -618,8 +730,70 @@ void UFEMFXMeshComponent::SetTetMeshMaterial(UFEMFXTetMeshParameters* newParamet
 	AMD::FmUpdateAllTetMaterialParams(Scene->GetSceneBuffer(), AMD::FmGetTetMesh(*GetTetMeshBuffer(), 0), tempMeshParams, plasticAttenuation);
 }
 
+void UFEMFXMeshComponent::SetSolveIterationScale(float Scale, int32 MinIterations)
+{
+	if (TetMeshBuffer == nullptr || !IsValid(FEMMesh))
+	{
+		return;
+	}
+
+	// FmUpdateAllTetMaterialParams replaces the whole material, so only meshes with one material for every tet qualify
+	const FComponentResources& Resource = FEMMesh->GetComponentResource();
+	const TArray<FMaterialTetAssignment>& Materials = Resource.Materials;
+	FString MaterialName = TEXT("Default");
+	if (Materials.Num() > 1)
+	{
+		return;
+	}
+	else if (Materials.Num() == 1)
+	{
+		if (Materials[0].TetIds.Num() != Resource.NumTets)
+		{
+			return;
+		}
+		MaterialName = Materials[0].Name;
+	}
+
+	UFEMFXTetMeshParameters* MeshP = MeshParameters.FindRef(MaterialName);
+	if (!IsValid(MeshP))
+	{
+		return;
+	}
+
+	int32 Iterations = FMath::Max(MinIterations, FMath::RoundToInt(MeshP->maxUnconstrainedSolveIterations * Scale));
+	Iterations = FMath::Min(Iterations, MeshP->maxUnconstrainedSolveIterations);
+
+	if (Iterations == AppliedSolveIterations || (AppliedSolveIterations < 0 && Iterations == MeshP->maxUnconstrainedSolveIterations))
+	{
+		return;
+	}
+
+	AMD::FmTetMaterialParams tempMeshParams;
+	tempMeshParams.fractureStressThreshold = MeshP->fractureStressThreshold;
+	tempMeshParams.lowerDeformationLimit = MeshP->lowerDeformationLimit;
+	tempMeshParams.maxUnconstrainedSolveIterations = Iterations;
+	tempMeshParams.plasticCreep = MeshP->plasticCreep;
+	tempMeshParams.plasticMax = MeshP->plasticMax;
+	tempMeshParams.plasticMin = MeshP->plasticMin;
+	tempMeshParams.plasticYieldThreshold = MeshP->plasticYieldThreshold;
+	tempMeshParams.poissonsRatio = MeshP->poissonsRatio;
+	tempMeshParams.restDensity = MeshP->restDensity;
+	tempMeshParams.upperDeformationLimit = MeshP->upperDeformationLimit;
+	tempMeshParams.youngsModulus = MeshP->youngsModulus;
+
+	// No scene passed so sleeping meshes are not woken by a quality change
+	AMD::uint NumTetMeshes = AMD::FmGetNumTetMeshes(*TetMeshBuffer);
+	for (AMD::uint meshIdx = 0; meshIdx < NumTetMeshes; meshIdx++)
+	{
+		AMD::FmUpdateAllTetMaterialParams(nullptr, AMD::FmGetTetMesh(*TetMeshBuffer, meshIdx), tempMeshParams);
+	}
+
+	AppliedSolveIterations = Iterations;
+}
+
 float UFEMFXMeshComponent::GetDestructionValue()
 {
+	WaitForSceneUpdate();
 
 	float totalDamage = 0;
 
@@ -701,6 +875,8 @@ void UFEMFXMeshComponent::BeginPlay()
 //It only does position for now
 void UFEMFXMeshComponent::SetTetMeshPositionAndRotation(FVector position, FRotator rotation)
 {
+	WaitForSceneUpdate();
+
 	AMD::FmVector3 newPos = ConvertUnrealToFEMFXVector(position) / 100;
 
     AMD::FmResetFromRestPositions(nullptr, TetMesh, AMD::FmMatrix3::identity(), newPos);
@@ -748,44 +924,78 @@ void UFEMFXMeshComponent::LoadResource()
 	//isInitialized = true;
 }
 
-void UFEMFXMeshComponent::LoadSimObject()
+// Decodes the packed incident tet list of the resource, a count followed by that many tet ids per vert
+static AMD::FmArray<unsigned int>* CreateVertIncidentTets(const FComponentResources& Resource)
 {
-	if (EditorOnly)
-		return;
-
-	int MaxVerts = MAX_VERTS_PER_MESH_BUFFER;
-	int MaxExteriorFaces = FEMMesh->GetComponentResource().NumTets * 4;
-
-	if (!FractureEnabled)
-	{
-		MaxVerts = FEMMesh->GetComponentResource().NumVerts;
-	}
-
-	AMD::FmArray<unsigned int>* vertIncidentTets = new AMD::FmArray<unsigned int>[FEMMesh->GetComponentResource().NumVerts];
+	AMD::FmArray<unsigned int>* vertIncidentTets = new AMD::FmArray<unsigned int>[Resource.NumVerts];
 	int currentNum = 0;
 	int lastNum = 0;
 	int currentArray = 0;
-	for (int i = 0; i < FEMMesh->GetComponentResource().vertIncidentTets.Num(); ++i)
+	for (int i = 0; i < Resource.vertIncidentTets.Num(); ++i)
 	{
 		if (i == 0)
 		{
-			currentNum = FEMMesh->GetComponentResource().vertIncidentTets[i];
+			currentNum = Resource.vertIncidentTets[i];
 		}
 		else
 		{
 			if (lastNum + currentNum >= i)
 			{
-				vertIncidentTets[currentArray].Add(FEMMesh->GetComponentResource().vertIncidentTets[i]);
+				vertIncidentTets[currentArray].Add(Resource.vertIncidentTets[i]);
 			}
 			else
 			{
 				currentArray++;
-				currentNum = FEMMesh->GetComponentResource().vertIncidentTets[i];
+				currentNum = Resource.vertIncidentTets[i];
 				lastNum = i;
 			}
 		}
 	}
 
+	return vertIncidentTets;
+}
+
+bool UFEMFXMeshComponent::ComputeTetMeshBufferBounds(AMD::FmTetMeshBufferBounds& OutBounds) const
+{
+	if (EditorOnly || !IsValid(FEMMesh))
+		return false;
+
+	const FComponentResources& Resource = FEMMesh->GetComponentResource();
+	if (Resource.NumVerts <= 0 || Resource.NumTets <= 0)
+		return false;
+
+	AMD::FmArray<unsigned int>* vertIncidentTets = CreateVertIncidentTets(Resource);
+	AMD::FmFractureGroupCounts* fractureGroupCounts = new AMD::FmFractureGroupCounts[Resource.NumTets];
+	AMD::uint* tetFractureGroupIds = new AMD::uint[Resource.NumTets];
+
+	AMD::FmComputeTetMeshBufferBounds(
+		&OutBounds,
+		fractureGroupCounts,
+		tetFractureGroupIds,
+		vertIncidentTets, reinterpret_cast<const AMD::FmTetVertIds*>(Resource.tetVertIds.GetData()), nullptr,
+		Resource.NumVerts, Resource.NumTets, FractureEnabled);
+
+	delete[] fractureGroupCounts;
+	delete[] tetFractureGroupIds;
+	delete[] vertIncidentTets;
+
+	return true;
+}
+
+void UFEMFXMeshComponent::LoadSimObject()
+{
+	if (EditorOnly)
+		return;
+
+	int MaxVerts = MAX_VERTS_PER_MESH_BUFFER;
+	int MaxExteriorFaces = FEMMesh->GetComponentResource().NumTets * 4;
+
+	if (!FractureEnabled)
+	{
+		MaxVerts = FEMMesh->GetComponentResource().NumVerts;
+	}
+
+	AMD::FmArray<unsigned int>* vertIncidentTets = CreateVertIncidentTets(FEMMesh->GetComponentResource());
 
     AMD::FmFractureGroupCounts* fractureGroupCounts = new AMD::FmFractureGroupCounts[FEMMesh->GetComponentResource().NumTets];
     AMD::uint* tetFractureGroupIds = new AMD::uint[FEMMesh->GetComponentResource().NumTets];
@@ -813,6 +1023,7 @@ void UFEMFXMeshComponent::LoadSimObject()
     tetMeshParams.collisionGroup = FEMMesh->GetComponentResource().CollisionGroup;
 
     TetMeshBuffer = FmCreateTetMeshBuffer(tetMeshParams, fractureGroupCounts, tetFractureGroupIds, &TetMesh);
+    TopologyGeneration++;
 
     delete[] fractureGroupCounts;
     delete[] tetFractureGroupIds;
@@ -956,6 +1167,8 @@ void UFEMFXMeshComponent::LoadSimObject()
 
         UE_LOG(FEMLog, Warning, TEXT("FEM component %s condition of mesh: %f"), *Name, meshCondition);
     }
+
+    UpdateLocalBounds();
 }
 
 TArray<FNameIndexMap> UFEMFXMeshComponent::GetTags()
@@ -981,6 +1194,8 @@ FNameIndexMap UFEMFXMeshComponent::GetTagByName(FString TagName)
 
 FTetVertex UFEMFXMeshComponent::GetTetVertById(int id, int subTetMesh)
 {
+	WaitForSceneUpdate();
+
 	FTetVertex vert = FTetVertex();
 
 	vert = CreateTetVertex(AMD::FmGetTetMesh(*TetMeshBuffer, subTetMesh), id);
@@ -990,6 +1205,8 @@ FTetVertex UFEMFXMeshComponent::GetTetVertById(int id, int subTetMesh)
 
 TArray<FTetInfo> UFEMFXMeshComponent::GetTetsByTag(FString tagName)
 {
+	WaitForSceneUpdate();
+
 	TArray<FTetInfo> tets;
 	FNameIndexMap tag = GetTagByName(tagName);
 
@@ -1025,7 +1242,14 @@ void UFEMFXMeshComponent::PostEditChangeProperty(FPropertyChangedEvent& Property
 
 void UFEMFXMeshComponent::UpdateRenderingDataFromFracture()
 {
-	TArray<FFEMFracture> FractureData;
+	GatherFractureData();
+	BroadcastFractureData();
+}
+
+void UFEMFXMeshComponent::GatherFractureData()
+{
+	TArray<FFEMFracture>& FractureData = PendingFractureData;
+	FractureData.Reset();
 
 	// Iterate over sub-meshes of the tet mesh buffer, to add new faces created during fracture
     AMD::uint NumTetMeshes = AMD::FmGetNumTetMeshes(*TetMeshBuffer);
@@ -1038,6 +1262,8 @@ void UFEMFXMeshComponent::UpdateRenderingDataFromFracture()
 
 		if (NumNewExteriorFaces > 0)
 		{
+            TopologyGeneration++;
+
             if (FEMMesh->GetTetMesh()->GetTetFractureShardVerticesToUpdate().Num() == 0) // original wood fracture import
             {
                 TetAssignmentsNeedUpdate = true;
@@ -1096,6 +1322,12 @@ void UFEMFXMeshComponent::UpdateRenderingDataFromFracture()
 		}
 	}
 
+}
+
+void UFEMFXMeshComponent::BroadcastFractureData()
+{
+	// Moved out so a handler that steps the scene again starts from an empty list
+	TArray<FFEMFracture> FractureData = MoveTemp(PendingFractureData);
 	FractureEvent.Broadcast(FractureData);
 }
 
@@ -1161,6 +1393,8 @@ TArray<FTetQueryData> UFEMFXMeshComponent::ApplyExplosionForce(const FVector& or
 	float shockwavePressure0, float shockwaveArea0,
 	float speed, float timestep, float timeSinceDetonated)
 {
+	WaitForSceneUpdate();
+
 	TArray<FTetQueryData> returnData;
 
 	float innerRadius = speed * timeSinceDetonated;
@@ -1269,6 +1503,8 @@ void UFEMFXMeshComponent::CreateFEMMeshFromTetMesh()
 
 void UFEMFXMeshComponent::Reset(FTransform startTrans)
 {
+	WaitForSceneUpdate();
+
 	AMD::FmVector3 pos = ConvertUnrealToFEMFXVector(startTrans.GetTranslation()) / 100;
 	FRotator Rotation = startTrans.Rotator();
 	FVector temp = Rotation.RotateVector(FVector(1.0, 0.0, 0.0));
@@ -1292,6 +1528,7 @@ void UFEMFXMeshComponent::Reset(FTransform startTrans)
 
 TArray<FTetQueryData> UFEMFXMeshComponent::TetMeshRadialQuery(FVector Pos, FVector Dir, float Radius)
 {
+	WaitForSceneUpdate();
 
 	AMD::FmVector3 Position = ConvertUnrealToFEMFXVector(Pos) / 100;
 	AMD::FmVector3 Direction = ConvertUnrealToFEMFXVector(Dir);
@@ -1343,13 +1580,46 @@ void UFEMFXMeshComponent::OnHit_Implementation(FEMCollision otherComponent)
 	
 }
 
+void UFEMFXMeshComponent::OnHits_Implementation(const TArray<FEMCollision>& Collisions)
+{
+	for (int32 i = 0; i < Collisions.Num(); ++i)
+	{
+		OnHit(Collisions[i]);
+	}
+}
+
+void UFEMFXMeshComponent::RebindTetMeshBuffer(AMD::FmTetMeshBuffer* NewTetMeshBuffer)
+{
+	if (TetMeshBuffer)
+	{
+		AMD::FmDestroyTetMeshBuffer(TetMeshBuffer);
+	}
+
+	TetMeshBuffer = NewTetMeshBuffer;
+	TetMesh = AMD::FmGetTetMesh(*TetMeshBuffer, 0);
+	TopologyGeneration++;
+
+	UpdateLocalBounds();
+}
+
 AMD::FmTetMeshBuffer* UFEMFXMeshComponent::GetTetMeshBuffer()
 {
 	return TetMeshBuffer;
 }
 
+void UFEMFXMeshComponent::WaitForSceneUpdate()
+{
+	// An asynchronous step reads and writes the tet mesh buffer until it finishes
+	if (IsValid(Scene))
+	{
+		Scene->WaitForAsyncUpdate();
+	}
+}
+
 FVector UFEMFXMeshComponent::GetVertPositionByIndex(int index, int subMeshIndex)
 {
+	WaitForSceneUpdate();
+
 	AMD::FmTetMesh* tetMesh = AMD::FmGetTetMesh(*TetMeshBuffer, subMeshIndex);
 	AMD::FmVector3 tempVec;
 	if (tetMesh == nullptr)
@@ -1373,6 +1643,8 @@ FVector UFEMFXMeshComponent::GetVertPositionByIndex(int index, int subMeshIndex)
 
 FVector UFEMFXMeshComponent::GetTetMeshCenterOfMass(int subMeshIndex)
 {
+	WaitForSceneUpdate();
+
 	AMD::FmTetMesh* tetMesh = AMD::FmGetTetMesh(*TetMeshBuffer, subMeshIndex);
 	AMD::FmVector3 tempVec;
 	if (tetMesh == nullptr)
@@ -1461,7 +1733,7 @@ void UFEMFXMeshComponent::PostEditSceneProxyUpdate() const
 	FFEMTetMeshRenderData RenderData;
 
 	RenderData.FEMMeshVertexPositions = FEMMesh->GetTetMesh()->GetVertexPositions();
-	RenderData.FEMMeshVertexRotations = FEMMesh->GetTetMesh()->GetVertexRotations();
+	PackFEMFXRotations(RenderData.FEMMeshVertexRotations, FEMMesh->GetTetMesh()->GetVertexRotations());
 	RenderData.FEMMeshDeformations = FEMMesh->GetTetMesh()->GetDeformations();
 	RenderData.FEMMeshTetVertexIds = FEMMesh->GetTetMesh()->GetTetVertexIds();
 
@@ -1473,73 +1745,257 @@ void UFEMFXMeshComponent::PostEditSceneProxyUpdate() const
 
 void UFEMFXMeshComponent::UpdateSceneProxy()
 {
-	FFEMTetMeshRenderData RenderData;
+	WaitForSceneUpdate();
+	CaptureSimState();
+	UpdateSceneProxyInterpolated(1.0f);
+}
 
-	FBox FEMMeshBox;
-    AMD::FmVector3 firstPos = AMD::FmGetVertPosition(*AMD::FmGetTetMesh(*TetMeshBuffer, 0), 0);
-	FEMMeshBox.Min = FEMMeshBox.Max = ConvertFEMFXVectorToUnreal(firstPos);
-	FEMMeshBox.IsValid = 1;
+/** Converts the positions of one sub-mesh into OutPositions, FEMFXSoaWidth vertices at a time */
+static void ReadTetMeshPositions(const AMD::FmTetMesh& TetMesh, FVector* OutPositions, FFEMFXSoaBounds& Bounds)
+{
+	AMD::FmVector3 Positions[FEMFXSoaWidth];
 
-	// Iterate over sub-meshes of the tet mesh buffer to add all vertices
-	int32 VertexOffset = 0;
-    AMD::uint NumTetMeshes = FmGetNumTetMeshes(*TetMeshBuffer);
+	const int32 NumVerts = (int32)FmGetNumVerts(TetMesh);
+	for (int32 BaseIdx = 0; BaseIdx < NumVerts; BaseIdx += FEMFXSoaWidth)
+	{
+		const int32 NumLanes = FMath::Min(NumVerts - BaseIdx, FEMFXSoaWidth);
+		for (int32 Lane = 0; Lane < FEMFXSoaWidth; Lane++)
+		{
+			Positions[Lane] = FmGetVertPosition(TetMesh, BaseIdx + FMath::Min(Lane, NumLanes - 1));
+		}
 
-    AMD::uint* TetMeshVertOffsets = new AMD::uint[NumTetMeshes];
+		ConvertFEMFXPositionsToUnreal4(OutPositions + BaseIdx, NumLanes, Positions, Bounds);
+	}
+}
 
-	for (AMD::uint meshIdx = 0; meshIdx < NumTetMeshes; meshIdx++)
+/** Sizes the staging arrays for every vertex of the buffer, keeping their allocations, and records where each sub-mesh starts */
+static int32 GetTetMeshBufferVertOffsets(const AMD::FmTetMeshBuffer& TetMeshBuffer, TArray<int32>& OutVertOffsets)
+{
+	AMD::uint NumTetMeshes = FmGetNumTetMeshes(TetMeshBuffer);
+	OutVertOffsets.SetNumUninitialized(NumTetMeshes, false);
+
+	int32 NumVerts = 0;
+	for (AMD::uint MeshIdx = 0; MeshIdx < NumTetMeshes; MeshIdx++)
 	{
-		AMD::FmTetMesh& tetMesh = *AMD::FmGetTetMesh(*TetMeshBuffer, meshIdx);
+		OutVertOffsets[MeshIdx] = NumVerts;
+		NumVerts += (int32)FmGetNumVerts(*AMD::FmGetTetMesh(TetMeshBuffer, MeshIdx));
+	}
 
-		TetMeshVertOffsets[meshIdx] = VertexOffset;
+	return NumVerts;
+}
 
-		AMD::uint numVerts = FmGetNumVerts(tetMesh);
-		for (AMD::uint vIdx = 0; vIdx < numVerts; vIdx++)
-		{
-			FVector pos = ConvertFEMFXVectorToUnreal(FmGetVertPosition(tetMesh, vIdx)) * 100;
-			RenderData.FEMMeshVertexPositions.Add(pos);
+void UFEMFXMeshComponent::ReadSimPositions(TArray<FVector>& OutPositions, FBox& OutBounds)
+{
+	int32 NumVerts = GetTetMeshBufferVertOffsets(*TetMeshBuffer, SubMeshVertOffsets);
+	OutPositions.SetNumUninitialized(NumVerts, false);
+
+	FFEMFXSoaBounds Bounds;
+	for (int32 MeshIdx = 0; MeshIdx < SubMeshVertOffsets.Num(); MeshIdx++)
+	{
+		ReadTetMeshPositions(*AMD::FmGetTetMesh(*TetMeshBuffer, MeshIdx), OutPositions.GetData() + SubMeshVertOffsets[MeshIdx], Bounds);
+	}
+
+	OutBounds = Bounds.ToBox();
+}
+
+void UFEMFXMeshComponent::CaptureStepStartPositions()
+{
+	// A mesh at rest starts the step where it was last captured, which CaptureSimState falls back to anyway
+	if (TetMeshBuffer == nullptr || bSimStateUnchanged)
+		return;
 
-			FFEMFXMeshTetRotation rotation;
-			AMD::FmMatrix3 rot = AMD::FmInitMatrix3(normalize(FmGetVertTetQuatSum(tetMesh, vIdx)));
-			ConvertFEMFXTetRotationToUnreal(rotation.Col0, rotation.Col1, rotation.Col2, rot);
-			RenderData.FEMMeshVertexRotations.Add(rotation);
+	ReadSimPositions(StepStartPositions, StepStartBounds);
+	bHasStepStartPositions = true;
+}
+
+void UFEMFXMeshComponent::CaptureSimState()
+{
+	if (TetMeshBuffer == nullptr)
+		return;
+
+	bSimStateUnchanged = false;
+	bUnchangedStateUploaded = false;
+	CapturedStateGeneration++;
+
+	// The state being replaced is where interpolation starts, unless positions were read just before the last step
+	if (bHasStepStartPositions)
+	{
+		Swap(PreviousSimPositions, StepStartPositions);
+		PreviousSimBounds = StepStartBounds;
+		bHasStepStartPositions = false;
+	}
+	else
+	{
+		Swap(PreviousSimPositions, SimRenderData.FEMMeshVertexPositions);
+		PreviousSimBounds = SimBounds;
+	}
+
+	// The staging arrays are members, so once they have grown to the mesh's size a capture doesn't allocate
+	FFEMTetMeshRenderData& RenderData = SimRenderData;
+	int32 NumVerts = GetTetMeshBufferVertOffsets(*TetMeshBuffer, SubMeshVertOffsets);
+	RenderData.FEMMeshVertexPositions.SetNumUninitialized(NumVerts, false);
+	RenderData.FEMMeshVertexRotations.SetNumUninitialized(NumVerts, false);
+	RenderData.FEMMeshDeformations.SetNumUninitialized(NumVerts, false);
 
-			RenderData.FEMMeshDeformations.Add(FmGetVertTetStrainMagMax(tetMesh, vIdx));
+	FFEMFXSoaBounds Bounds;
+	AMD::FmVector3 Positions[FEMFXSoaWidth];
+	AMD::FmQuat QuatSums[FEMFXSoaWidth];
+
+	for (int32 MeshIdx = 0; MeshIdx < SubMeshVertOffsets.Num(); MeshIdx++)
+	{
+		const AMD::FmTetMesh& TetMesh = *AMD::FmGetTetMesh(*TetMeshBuffer, MeshIdx);
+		const int32 VertOffset = SubMeshVertOffsets[MeshIdx];
+		const int32 NumMeshVerts = (int32)FmGetNumVerts(TetMesh);
+
+		for (int32 BaseIdx = 0; BaseIdx < NumMeshVerts; BaseIdx += FEMFXSoaWidth)
+		{
+			// A partial batch repeats its last vertex in the unused lanes, which leaves the bounds unchanged
+			const int32 NumLanes = FMath::Min(NumMeshVerts - BaseIdx, FEMFXSoaWidth);
+			for (int32 Lane = 0; Lane < FEMFXSoaWidth; Lane++)
+			{
+				const AMD::uint VertIdx = BaseIdx + FMath::Min(Lane, NumLanes - 1);
+				Positions[Lane] = FmGetVertPosition(TetMesh, VertIdx);
+				QuatSums[Lane] = FmGetVertTetQuatSum(TetMesh, VertIdx);
+			}
 
-			FEMMeshBox += pos;
+			for (int32 Lane = 0; Lane < NumLanes; Lane++)
+			{
+				RenderData.FEMMeshDeformations[VertOffset + BaseIdx + Lane] = FmGetVertTetStrainMagMax(TetMesh, BaseIdx + Lane);
+			}
 
-			VertexOffset++;
+			ConvertFEMFXPositionsToUnreal4(RenderData.FEMMeshVertexPositions.GetData() + VertOffset + BaseIdx, NumLanes, Positions, Bounds);
+			PackFEMFXQuatSumsToUnreal4(RenderData.FEMMeshVertexRotations.GetData() + VertOffset + BaseIdx, NumLanes, QuatSums);
 		}
 	}
 
+	// A change in sub-mesh count means fracture, even if it was not reported yet
 	AMD::uint NumTets = FmGetNumTets(*TetMeshBuffer);
-	for (AMD::uint BufferTetIdx = 0; BufferTetIdx < NumTets; BufferTetIdx++)
+	if (CapturedTopologyGeneration != TopologyGeneration || CapturedTopologyNumSubMeshes != SubMeshVertOffsets.Num()
+		|| RenderData.FEMMeshTetVertexIds.Num() != (int32)NumTets)
 	{
-		AMD::uint TetId, MeshIdx;
-		AMD::FmTetMesh* SubTetMesh = FmGetTetMeshContainingTet(&TetId, &MeshIdx, *TetMeshBuffer, BufferTetIdx);
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMFXMesh_CaptureTetVertexIds);
 
-		AMD::uint SubMeshVertOffset = TetMeshVertOffsets[MeshIdx];
+		RenderData.FEMMeshTetVertexIds.SetNumUninitialized(NumTets, false);
+		FFEMFXMeshTetVertexIds* OutTetVertexIds = RenderData.FEMMeshTetVertexIds.GetData();
 
-        AMD::FmTetVertIds tetVertIds = FmGetTetVertIds(*SubTetMesh, TetId);
+		for (AMD::uint BufferTetIdx = 0; BufferTetIdx < NumTets; BufferTetIdx++)
+		{
+			AMD::uint TetId, MeshIdx;
+			AMD::FmTetMesh* SubTetMesh = FmGetTetMeshContainingTet(&TetId, &MeshIdx, *TetMeshBuffer, BufferTetIdx);
 
-		FFEMFXMeshTetVertexIds VertexIds;
-		VertexIds.Id0 = tetVertIds.ids[0];
-		VertexIds.Id1 = tetVertIds.ids[1];
-		VertexIds.Id2 = tetVertIds.ids[2];
-		VertexIds.Id3 = tetVertIds.ids[3];
+			const int32 SubMeshVertOffset = SubMeshVertOffsets[MeshIdx];
+			AMD::FmTetVertIds tetVertIds = FmGetTetVertIds(*SubTetMesh, TetId);
 
-		VertexIds.Id0 += SubMeshVertOffset;
-		VertexIds.Id1 += SubMeshVertOffset;
-		VertexIds.Id2 += SubMeshVertOffset;
-		VertexIds.Id3 += SubMeshVertOffset;
+			FFEMFXMeshTetVertexIds& VertexIds = OutTetVertexIds[BufferTetIdx];
+			VertexIds.Id0 = tetVertIds.ids[0] + SubMeshVertOffset;
+			VertexIds.Id1 = tetVertIds.ids[1] + SubMeshVertOffset;
+			VertexIds.Id2 = tetVertIds.ids[2] + SubMeshVertOffset;
+			VertexIds.Id3 = tetVertIds.ids[3] + SubMeshVertOffset;
+		}
 
-		RenderData.FEMMeshTetVertexIds.Add(VertexIds);
+		// Rebuilds found by the size checks have no fracture report behind them, so each rebuild starts a generation of its own
+		CapturedTopologyGeneration = ++TopologyGeneration;
+		CapturedTopologyNumSubMeshes = SubMeshVertOffsets.Num();
 	}
 
-    delete[] TetMeshVertOffsets;
-	
+	SimBounds = Bounds.ToBox();
+}
+
+void UFEMFXMeshComponent::MarkSimStateUnchanged()
+{
+	if (!bSimStateUnchanged)
+	{
+		bSimStateUnchanged = true;
+		bUnchangedStateUploaded = false;
+	}
+	bHasStepStartPositions = false;
+}
+
+void UFEMFXMeshComponent::ResetRenderInterpolation()
+{
+	PreviousSimPositions = SimRenderData.FEMMeshVertexPositions;
+	PreviousSimBounds = SimBounds;
+	bHasStepStartPositions = false;
+}
+
+void UFEMFXMeshComponent::UpdateSceneProxyInterpolated(float Alpha)
+{
+	if (TetMeshBuffer == nullptr || SimRenderData.FEMMeshVertexPositions.Num() == 0)
+		return;
+
+	// Nothing moved since the last capture, show that state once instead of blending towards it every frame
+	if (bSimStateUnchanged)
+	{
+		if (bUnchangedStateUploaded)
+			return;
+
+		bUnchangedStateUploaded = true;
+		Alpha = 1.0f;
+	}
+
+	const TArray<FVector>& CurrentPositions = SimRenderData.FEMMeshVertexPositions;
+	FBox FEMMeshBox = SimBounds;
+
+	// Fracture can add vertices, in which case there is nothing to blend from for this step
+	bool bInterpolate = Alpha < 1.0f && PreviousSimPositions.Num() == CurrentPositions.Num();
+
 	if (SceneProxy)
 	{
-		static_cast<FFEMFXMeshSceneProxy*>(SceneProxy)->UpdateTetMesh(RenderData, true);
+		FFEMFXMeshSceneProxy* FEMFXMeshSceneProxy = static_cast<FFEMFXMeshSceneProxy*>(SceneProxy);
+		FFEMFXMeshStagingSlot* Slot = FEMFXMeshSceneProxy->BeginStagingSlot();
+
+		if (Slot)
+		{
+			const bool bPack = bPackRenderPositions && SubMeshVertOffsets.Num() <= FEMFXMaxPackedPositionSubMeshes;
+			const int32 NumVerts = CurrentPositions.Num();
+
+			// Blended positions are written straight into the slot, unless they are packed from there
+			TArray<FVector>& BlendedPositions = bPack ? InterpolatedPositions : Slot->Positions;
+			if (bInterpolate)
+			{
+				BlendedPositions.SetNumUninitialized(NumVerts, false);
+				for (int32 VertIdx = 0; VertIdx < NumVerts; VertIdx++)
+				{
+					BlendedPositions[VertIdx] = FMath::Lerp(PreviousSimPositions[VertIdx], CurrentPositions[VertIdx], Alpha);
+				}
+			}
+
+			if (bPack)
+			{
+				PackFEMFXPositions(Slot->PackedPositions, Slot->PositionBounds, bInterpolate ? InterpolatedPositions : CurrentPositions, SubMeshVertOffsets);
+			}
+			else if (!bInterpolate)
+			{
+				Slot->Positions.Append(CurrentPositions);
+			}
+			Slot->bPackedPositions = bPack;
+
+			// Rotations and deformations only change with a capture, blending positions between captures leaves them alone
+			if (UploadedStateGeneration != CapturedStateGeneration)
+			{
+				Slot->Rotations.Append(SimRenderData.FEMMeshVertexRotations);
+				Slot->Deformations.Append(SimRenderData.FEMMeshDeformations);
+				UploadedStateGeneration = CapturedStateGeneration;
+			}
+
+			if (UploadedTopologyGeneration != CapturedTopologyGeneration)
+			{
+				Slot->TetVertexIds.Append(SimRenderData.FEMMeshTetVertexIds);
+				UploadedTopologyGeneration = CapturedTopologyGeneration;
+			}
+
+			FEMFXMeshSceneProxy->SubmitStagingSlot(Slot, true);
+		}
+		else if (bSimStateUnchanged)
+		{
+			// The render thread is still uploading older slots, send the final state next frame instead
+			bUnchangedStateUploaded = false;
+		}
+	}
+
+	if (bInterpolate)
+	{
+		FEMMeshBox += PreviousSimBounds;
 	}
 
 	LocalBounds = FEMMeshBox;
@@ -1548,8 +2004,34 @@ void UFEMFXMeshComponent::UpdateSceneProxy()
 	MarkRenderTransformDirty();
 }
 
+float UFEMFXMeshComponent::MeasurePackedPositionError()
+{
+	const TArray<FVector>& Positions = SimRenderData.FEMMeshVertexPositions;
+	if (Positions.Num() == 0 || SubMeshVertOffsets.Num() > FEMFXMaxPackedPositionSubMeshes)
+		return 0.0f;
+
+	PackFEMFXPositions(PackedPositions, PackedPositionBounds, Positions, SubMeshVertOffsets);
+
+	float MaxError = 0.0f;
+	double SumError = 0.0;
+	for (int32 VertIdx = 0; VertIdx < Positions.Num(); VertIdx++)
+	{
+		float Error = FVector::Dist(UnpackFEMFXPosition(PackedPositions[VertIdx], PackedPositionBounds), Positions[VertIdx]);
+		MaxError = FMath::Max(MaxError, Error);
+		SumError += Error;
+	}
+
+	const int32 FloatBytes = Positions.Num() * sizeof(FVector);
+	const int32 PackedBytes = PackedPositions.Num() * sizeof(FFEMFXMeshPackedPosition) + PackedPositionBounds.Num() * sizeof(FFEMFXMeshPositionBounds);
+	UE_LOG(FEMLog, Log, TEXT("%s: packed positions of %d verts in %d sub-meshes, max error %f cm, mean error %f cm, %d bytes instead of %d"),
+		*GetName(), Positions.Num(), PackedPositionBounds.Num(), MaxError, (float)(SumError / Positions.Num()), PackedBytes, FloatBytes);
+
+	return MaxError;
+}
+
 void UFEMFXMeshComponent::ResetFromRestPosition(FTransform transform, FVector velocity)
 {
+	WaitForSceneUpdate();
 
 	FRotator rot = transform.Rotator();
 	FVector position = transform.GetTranslation();
@@ -1604,6 +2086,27 @@ void UFEMFXMeshComponent::SetMeshSectionVisible(int32 SectionIndex, bool bNewVis
     }
 }
 
+/** Union of the bounds FEMFX keeps for each sub-mesh, invalid if none has been computed yet */
+static FBox GetTetMeshBufferBounds(const AMD::FmTetMeshBuffer& TetMeshBuffer)
+{
+	FBox Box(ForceInit);
+
+	AMD::uint NumTetMeshes = FmGetNumTetMeshes(TetMeshBuffer);
+	for (AMD::uint MeshIdx = 0; MeshIdx < NumTetMeshes; MeshIdx++)
+	{
+		const AMD::FmTetMesh& SubTetMesh = *AMD::FmGetTetMesh(TetMeshBuffer, MeshIdx);
+		AMD::FmVector3 MinPosition = AMD::FmGetMinPosition(SubTetMesh);
+		AMD::FmVector3 MaxPosition = AMD::FmGetMaxPosition(SubTetMesh);
+
+		if (MinPosition.x <= MaxPosition.x && MinPosition.y <= MaxPosition.y && MinPosition.z <= MaxPosition.z)
+		{
+			Box += ConvertFEMFXBoundsToUnreal(MinPosition, MaxPosition);
+		}
+	}
+
+	return Box;
+}
+
 void UFEMFXMeshComponent::UpdateLocalBounds()
 {
 	if (!IsValid(FEMMesh))
@@ -1611,16 +2114,23 @@ void UFEMFXMeshComponent::UpdateLocalBounds()
 		return;
 	}
 
+    // Until the first capture, the simulated mesh is bounded by what FEMFX reports, an unloaded one by its sections
     FBox LocalBox(ForceInit);
 
-    for (const FFEMFXMeshSection& Section : FEMMesh->GetImportedResource()->GetMeshSections())
+    if (TetMeshBuffer)
     {
-        LocalBox += Section.SectionLocalBox;
+        LocalBox = GetTetMeshBufferBounds(*TetMeshBuffer);
     }
 
-    LocalBounds = LocalBox.IsValid ? FBoxSphereBounds(LocalBox) : FBoxSphereBounds(FVector(0, 0, 0), FVector(0, 0, 0), 0); // fallback to reset box sphere bounds
+    if (!LocalBox.IsValid)
+    {
+        for (const FFEMFXMeshSection& Section : FEMMesh->GetImportedResource()->GetMeshSections())
+        {
+            LocalBox += Section.SectionLocalBox;
+        }
+    }
 
-    LocalBounds = FBoxSphereBounds(FVector(0, 0, 0), FVector(1e3f, 1e3f, 1e3f), 1e3f);
+    LocalBounds = LocalBox.IsValid ? FBoxSphereBounds(LocalBox) : FBoxSphereBounds(FVector(0, 0, 0), FVector(0, 0, 0), 0); // fallback to reset box sphere bounds
 
     // Update global bounds
     UpdateBounds();
@@ -1631,6 +2141,10 @@ void UFEMFXMeshComponent::UpdateLocalBounds()
 FPrimitiveSceneProxy* UFEMFXMeshComponent::CreateSceneProxy()
 {
     // SCOPE_CYCLE_COUNTER(STAT_FEMFXMesh_CreateSceneProxy);
+
+    // A new proxy starts from the asset's tet mesh state
+    UploadedTopologyGeneration = 0;
+    UploadedStateGeneration = 0;
     return new FFEMFXMeshSceneProxy(this);
 }
 
@@ -1737,33 +2251,8 @@ FBoxSphereBounds UFEMFXMeshComponent::CalcBounds(const FTransform& LocalToWorld)
 	{
 		if (TetMeshBuffer)
 		{
-			FBox FEMMeshBox;
-            AMD::FmVector3 firstPos = AMD::FmGetVertPosition(*AMD::FmGetTetMesh(*TetMeshBuffer, 0), 0);
-			FEMMeshBox.Min = FEMMeshBox.Max = ConvertFEMFXVectorToUnreal(firstPos);
-			FEMMeshBox.IsValid = 1;
-
-			// Iterate over sub-meshes of the tet mesh buffer to add all vertices
-			int32 VertexOffset = 0;
-
-            AMD::uint NumTetMeshes = FmGetNumTetMeshes(*TetMeshBuffer);
-
-			for (AMD::uint meshIdx = 0; meshIdx < NumTetMeshes; meshIdx++)
-			{
-				AMD::FmTetMesh& tetMesh = *AMD::FmGetTetMesh(*TetMeshBuffer, meshIdx);
-
-				AMD::uint numVerts = FmGetNumVerts(tetMesh);
-				for (AMD::uint vIdx = 0; vIdx < numVerts; vIdx++)
-				{
-					FVector pos = ConvertFEMFXVectorToUnreal(AMD::FmGetVertPosition(tetMesh, vIdx)) * 100;
-
-					FEMMeshBox += pos;
-
-					VertexOffset++;
-				}
-			}
-
-			Ret = FEMMeshBox;
-
+			// Kept current by UpdateLocalBounds and by the render data capture, which gathers the bounds in its pass over the vertices
+			Ret = LocalBounds.TransformBy(LocalToWorld);
 		}
 		else if (FEMMesh)
 		{
@@ -1801,6 +2290,8 @@ void UFEMFXMeshComponent::UpdateCollision()
 
 void UFEMFXMeshComponent::SetTetKinematic(int TetId, bool IsKinematic, bool IsRemovable, FVector KinematicVelocity)
 {
+	WaitForSceneUpdate();
+
 	if ((int)FmGetNumTets(*GetTetMeshPtr()) <= TetId) return;
 
     AMD::FmTetVertIds TetVerts = AMD::FmGetTetVertIds(*GetTetMeshPtr(), TetId);
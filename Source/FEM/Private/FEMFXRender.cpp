@@ -15,6 +15,9 @@ FEMFXVertexFactory.cpp: Local vertex factory implementation
 void FFEMFXMeshVertexFactoryShaderParameters::Bind(const FShaderParameterMap& ParameterMap)
 {
     TetMeshVertexPosBufferParameter.Bind(ParameterMap, TEXT("TetMeshVertexPosBuffer"));
+    TetMeshVertexPackedPosBufferParameter.Bind(ParameterMap, TEXT("TetMeshVertexPackedPosBuffer"));
+    TetMeshPositionBoundsBufferParameter.Bind(ParameterMap, TEXT("TetMeshPositionBoundsBuffer"));
+    TetMeshVertexPosPackedParameter.Bind(ParameterMap, TEXT("TetMeshVertexPosPacked"));
     TetMeshVertexRotBufferParameter.Bind(ParameterMap, TEXT("TetMeshVertexRotBuffer"));
 	TetMeshDeformationBufferParameter.Bind(ParameterMap, TEXT("TetMeshDeformationBuffer"));
     TetVertexIdBufferParameter.Bind(ParameterMap, TEXT("TetVertexIdBuffer"));
@@ -25,6 +28,9 @@ void FFEMFXMeshVertexFactoryShaderParameters::Bind(const FShaderParameterMap& Pa
 void FFEMFXMeshVertexFactoryShaderParameters::Serialize(FArchive& Ar)
 {
     Ar << TetMeshVertexPosBufferParameter
+        << TetMeshVertexPackedPosBufferParameter
+        << TetMeshPositionBoundsBufferParameter
+        << TetMeshVertexPosPackedParameter
         << TetMeshVertexRotBufferParameter
         << TetMeshDeformationBufferParameter
         << TetVertexIdBufferParameter
@@ -118,6 +124,8 @@ void FFEMFXMeshVertexFactoryShaderParameters::GetElementShaderBindings(
         check(BatchElementParams);
 
         FShaderResourceViewRHIRef TetMeshVertexPosBufferSRV = BatchElementParams->TetMeshVertexPosBufferSRV;
+        FShaderResourceViewRHIRef TetMeshVertexPackedPosBufferSRV = BatchElementParams->TetMeshVertexPackedPosBufferSRV;
+        FShaderResourceViewRHIRef TetMeshPositionBoundsBufferSRV = BatchElementParams->TetMeshPositionBoundsBufferSRV;
         FShaderResourceViewRHIRef TetMeshVertexRotBufferSRV = BatchElementParams->TetMeshVertexRotBufferSRV;
         FShaderResourceViewRHIRef TetMeshDeformationBufferSRV = BatchElementParams->TetMeshDeformationBufferSRV;
         FShaderResourceViewRHIRef TetVertexIdBufferSRV = BatchElementParams->TetVertexIdBufferSRV;
@@ -131,6 +139,27 @@ void FFEMFXMeshVertexFactoryShaderParameters::GetElementShaderBindings(
                 ShaderBindings.Add(TetMeshVertexPosBufferParameter, TetMeshVertexPosBufferSRV);
             }
         }
+        if (TetMeshVertexPackedPosBufferParameter.IsBound() && TetMeshVertexPackedPosBufferSRV)
+        {
+            if (Shader->GetTarget().Frequency == SF_Vertex)
+            {
+                ShaderBindings.Add(TetMeshVertexPackedPosBufferParameter, TetMeshVertexPackedPosBufferSRV);
+            }
+        }
+        if (TetMeshPositionBoundsBufferParameter.IsBound() && TetMeshPositionBoundsBufferSRV)
+        {
+            if (Shader->GetTarget().Frequency == SF_Vertex)
+            {
+                ShaderBindings.Add(TetMeshPositionBoundsBufferParameter, TetMeshPositionBoundsBufferSRV);
+            }
+        }
+        if (TetMeshVertexPosPackedParameter.IsBound())
+        {
+            if (Shader->GetTarget().Frequency == SF_Vertex)
+            {
+                ShaderBindings.Add(TetMeshVertexPosPackedParameter, BatchElementParams->bPackedPositions ? 1u : 0u);
+            }
+        }
         if (TetMeshVertexRotBufferParameter.IsBound() && TetMeshVertexRotBufferSRV)
         {
             if (Shader->GetTarget().Frequency == SF_Vertex)
@@ -10,7 +10,54 @@
 #include "FEMMesh.h"
 #include "FEMActor.h"
 #include "FEMCommon.h"
+#include "FEM.h"
 #include "sample_task_system.h"
+#include "Kismet/GameplayStatics.h"
+#include "FEMFXSerialize.h"
+#include "ProceduralMeshHelper.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Budget Update ms"), STAT_FEMBudget_UpdateMs, STATGROUP_FEM);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Budget Solve Quality"), STAT_FEMBudget_SolveQuality, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Budget Max Steps"), STAT_FEMBudget_MaxSteps, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Render Data Updated"), STAT_FEM_RenderDataUpdated, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Render Data Skipped"), STAT_FEM_RenderDataSkipped, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Task Pool In Use"), STAT_FEM_TaskPoolInUse, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Task Pool Peak"), STAT_FEM_TaskPoolPeak, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Task Pool Overflows"), STAT_FEM_TaskPoolOverflows, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sync Event Pool In Use"), STAT_FEM_EventPoolInUse, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sync Event Pool Peak"), STAT_FEM_EventPoolPeak, STATGROUP_FEM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sync Event Pool Overflows"), STAT_FEM_EventPoolOverflows, STATGROUP_FEM);
+
+// Below this many components the per-component reads are cheaper than waking task graph workers
+static const int32 FEMParallelComponentThreshold = 4;
+
+// Vertices sampled per tet mesh for the motion signal, and how many unchanged reads in a row before its render data is no longer captured
+static const int32 FEMMotionSampleVerts = 8;
+static const int32 FEMStillReadsBeforeSkip = 4;
+
+// Worker thread calibration: a block of cubes dropped on the floor plane, stepped at each thread count
+static const int32 FEMCalibrationBlockCubes = 8;
+static const float FEMCalibrationCubeSize = 0.1f;
+static const int32 FEMCalibrationWarmupSteps = 4;
+static const int32 FEMCalibrationMeasuredSteps = 8;
+
+// Scene limits that can be raised by recreating the scene, the per tet mesh buffer limits are fixed when the buffer is created
+#define FEM_SCENE_CAPACITY_WARNING_FLAGS ( \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_TET_MESHES | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_BROAD_PHASE_PAIRS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_RIGID_BODY_BROAD_PHASE_PAIRS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_DISTANCE_CONTACTS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_VOLUME_CONTACTS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_VOLUME_CONTACT_VERTS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_DEFORMATION_CONSTRAINTS | \
+	FM_WARNING_FLAG_HIT_LIMIT_SCENE_CONSTRAINT_SOLVER_MEMORY)
+
+static int32 GrowCapacity(int32 Current, float Factor, int64 Needed = 0)
+{
+	int64 Grown = FMath::Max<int64>((int64)FMath::CeilToDouble(Current * (double)Factor), (int64)Current + 1);
+	return (int32)FMath::Min<int64>(FMath::Max(Grown, Needed), MAX_int32);
+}
 
 void* FmAlignedMalloc(size_t size, size_t alignment)
 {
@@ -22,6 +69,43 @@ void FmAlignedFree(void* ptr)
     _aligned_free(ptr);
 }
 
+static void UpdateTaskSystemPoolStats()
+{
+	AMD::SampleTaskSystemPoolStats PoolStats;
+	AMD::SampleGetTaskSystemPoolStats(PoolStats);
+
+	SET_DWORD_STAT(STAT_FEM_TaskPoolInUse, PoolStats.numTasksInUse);
+	SET_DWORD_STAT(STAT_FEM_TaskPoolPeak, PoolStats.peakTasksInUse);
+	SET_DWORD_STAT(STAT_FEM_TaskPoolOverflows, PoolStats.numTaskOverflows);
+	SET_DWORD_STAT(STAT_FEM_EventPoolInUse, PoolStats.numEventsInUse);
+	SET_DWORD_STAT(STAT_FEM_EventPoolPeak, PoolStats.peakEventsInUse);
+	SET_DWORD_STAT(STAT_FEM_EventPoolOverflows, PoolStats.numEventOverflows);
+}
+
+static void SetSceneTaskSystemCallbacks(AMD::FmScene* Scene)
+{
+    AMD::FmTaskSystemCallbacks taskSystemCallbacks;
+
+    taskSystemCallbacks.SetCallbacks(
+        AMD::SampleGetTaskSystemNumThreads,
+        AMD::SampleGetTaskSystemWorkerIndex,
+        AMD::SampleAsyncTask,
+        AMD::SampleCreateSyncEvent,
+        AMD::SampleDestroySyncEvent,
+        AMD::SampleWaitForSyncEvent,
+        AMD::SampleTriggerSyncEvent
+#if !FM_ASYNC_THREADING
+        SampleCreateTaskWaitCounter,
+        SampleWaitForTaskWaitCounter,
+        SampleDestroyTaskWaitCounter,
+        SampleSubmitTask,
+        SampleParallelFor
+#endif
+    );
+
+    AMD::FmSetSceneTaskSystemCallbacks(Scene, taskSystemCallbacks);
+}
+
 AFEMFXScene::AFEMFXScene(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -45,11 +129,30 @@ AFEMFXScene::AFEMFXScene(const FObjectInitializer& ObjectInitializer)
 	MaxVerts = MAX_VERTS_PER_MESH_BUFFER * MAX_MESH_BUFFERS;
 	MaxJacobianSubmats = MAX_CONTACTS * 8;
 	NumWorkerThreads = 1;
+	bCalibrateWorkerThreads = false;
+	CalibrationBasePower = 2.0f;
+	bAutoSizeCapacities = false;
+	CapacityHeadroom = 0.25f;
+	MaxTetMeshBufferFeatures = 16384;
+	MaxConstraintSolverDataSize = 100000000;
+	bGrowOnOverflow = true;
+	GrowthFactor = 2.0f;
+	PendingGrowFlags = 0;
+	SnapshotCapacity = 8;
+	SnapshotSlotBytes = 0;
+	bCaptureInitialSnapshot = true;
+	NextSnapshotId = 1;
+	bInitialSnapshotPending = true;
 
 	bAllowTick = true;
+	bAsyncUpdate = false;
+	AsyncUpdateEvent = nullptr;
+	bAsyncUpdateInFlight = false;
     lastTimestep = 1.0f / 60.0f;
 
-	frameTime = 1.0f/60.0f;
+	MaxSteps = 2;
+	SimulationRate = 60.0f;
+	bInterpolateRendering = true;
 	timeElapsed = 0.0f;
 
 	PrimaryActorTick.bCanEverTick = true;
@@ -60,6 +163,21 @@ AFEMFXScene::AFEMFXScene(const FObjectInitializer& ObjectInitializer)
 	MaxVolumeContactsPerObjectPair = 0;
 	MinContactRelativeVelocity = 1.0;
 
+	bEnableBudgetGovernor = false;
+	BudgetMilliseconds = 4.0f;
+	MinStepsFloor = 1;
+	MinSolveQualityScale = 0.25f;
+	MinUnconstrainedSolveIterations = 5;
+	MinConstraintSolveIterations = 1;
+	BudgetUpdateMilliseconds = 0.0f;
+	BudgetSolveQualityScale = 1.0f;
+	BudgetMaxSteps = 2;
+	AsyncUpdateStartTime = 0.0;
+	AsyncUpdateEndTime = 0.0;
+	FrameUpdateSeconds = 0.0;
+	BudgetNextAdjustTime = 0.0f;
+	AppliedSolveQualityScale = 1.0f;
+
 	//AddToRoot();
 
 }
@@ -82,7 +200,172 @@ AFEMFXScene::AFEMFXScene(const FObjectInitializer& ObjectInitializer)
 
 void AFEMFXScene::ResetScene_Implementation()
 {
+	if (InitialSnapshot.Id == INDEX_NONE)
+	{
+		UE_LOG(FEMLog, Warning, TEXT("FEM scene %s has no initial snapshot to reset to"), *Name);
+		return;
+	}
+
+	ReadSnapshot(InitialSnapshot);
+}
+
+int32 AFEMFXScene::CaptureSnapshot()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_CaptureSnapshot);
+
+	if (!AMDFXSceneBuffer || SnapshotCapacity <= 0)
+		return INDEX_NONE;
+
+	WaitForAsyncUpdate();
+
+	if (Snapshots.Num() != SnapshotCapacity)
+	{
+		Snapshots.Reset();
+		Snapshots.SetNum(SnapshotCapacity);
+	}
+
+	int32 SnapshotId = NextSnapshotId;
+	FFEMSceneSnapshot& Snapshot = Snapshots[SnapshotId % SnapshotCapacity];
+	Snapshot.Id = INDEX_NONE;
+
+	if (!WriteSnapshot(Snapshot))
+		return INDEX_NONE;
+
+	Snapshot.Id = SnapshotId;
+	NextSnapshotId++;
+
+	return SnapshotId;
+}
+
+bool AFEMFXScene::RestoreSnapshot(int32 SnapshotId)
+{
+	if (SnapshotId < 0 || Snapshots.Num() == 0 || Snapshots[SnapshotId % Snapshots.Num()].Id != SnapshotId)
+	{
+		UE_LOG(FEMLog, Warning, TEXT("FEM scene %s no longer holds snapshot %d"), *Name, SnapshotId);
+		return false;
+	}
+
+	return ReadSnapshot(Snapshots[SnapshotId % Snapshots.Num()]);
+}
+
+TArray<int32> AFEMFXScene::GetSnapshotIds() const
+{
+	TArray<int32> SnapshotIds;
+	for (const FFEMSceneSnapshot& Snapshot : Snapshots)
+	{
+		if (Snapshot.Id != INDEX_NONE)
+		{
+			SnapshotIds.Add(Snapshot.Id);
+		}
+	}
+	SnapshotIds.Sort();
+
+	return SnapshotIds;
+}
+
+void AFEMFXScene::ClearSnapshots()
+{
+	for (FFEMSceneSnapshot& Snapshot : Snapshots)
+	{
+		Snapshot.Id = INDEX_NONE;
+	}
+}
+
+bool AFEMFXScene::WriteSnapshot(FFEMSceneSnapshot& Snapshot)
+{
+	// FmSerializeScene can only write into a buffer it allocates, so that is copied into the slot's reserved memory and freed straight away
+	size_t SerializedSize = 0;
+	uint8_t* Serialized = AMD::FmSerializeScene(&SerializedSize, *AMDFXSceneBuffer);
+	if (!Serialized)
+	{
+		UE_LOG(FEMLog, Error, TEXT("FEM scene %s could not be serialized for a snapshot"), *Name);
+		return false;
+	}
+
+	if (SerializedSize > (size_t)SnapshotSlotBytes)
+	{
+		bool bResized = SnapshotSlotBytes > 0;
+		SnapshotSlotBytes = (int32)FMath::Min<size_t>(SerializedSize + SerializedSize / 4, MAX_int32);
+
+		if (bResized)
+		{
+			UE_LOG(FEMLog, Warning, TEXT("FEM scene %s outgrew its snapshot slots, reserving %d bytes for each of %d"), *Name, SnapshotSlotBytes, Snapshots.Num());
+		}
+
+		for (FFEMSceneSnapshot& Slot : Snapshots)
+		{
+			Slot.Data.Reserve(SnapshotSlotBytes);
+		}
+	}
+
+	Snapshot.Data.SetNumUninitialized((int32)SerializedSize, false);
+	FMemory::Memcpy(Snapshot.Data.GetData(), Serialized, SerializedSize);
+	FmAlignedFree(Serialized);
+
+	GetSerializedObjectOwners(SnapshotBufferOwners, SnapshotRigidBodies);
+
+	Snapshot.BufferOwners.Reset();
+	for (UFEMFXMeshComponent* Owner : SnapshotBufferOwners)
+	{
+		Snapshot.BufferOwners.Add(Owner);
+	}
+	Snapshot.NumRigidBodies = SnapshotRigidBodies.Num();
+
+	return true;
+}
+
+bool AFEMFXScene::ReadSnapshot(const FFEMSceneSnapshot& Snapshot)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_ReadSnapshot);
+
+	if (!AMDFXSceneBuffer)
+		return false;
+
+	WaitForAsyncUpdate();
+
+	// Deserializing clears the scene, so only go ahead if it holds exactly the objects the snapshot was taken with
+	GetSerializedObjectOwners(SnapshotBufferOwners, SnapshotRigidBodies);
+
+	bool bSameObjects = SnapshotBufferOwners.Num() == Snapshot.BufferOwners.Num() && SnapshotRigidBodies.Num() == Snapshot.NumRigidBodies;
+	for (int32 i = 0; bSameObjects && i < Snapshot.BufferOwners.Num(); i++)
+	{
+		UFEMFXMeshComponent* Owner = Snapshot.BufferOwners[i].Get();
+		bSameObjects = Owner && SnapshotBufferOwners.Contains(Owner);
+	}
 
+	if (!bSameObjects)
+	{
+		UE_LOG(FEMLog, Warning, TEXT("FEM scene %s: meshes or rigid bodies were added or removed since snapshot %d was taken, not restoring"), *Name, Snapshot.Id);
+		return false;
+	}
+
+	TArray<UFEMFXMeshComponent*> BufferOwners;
+	BufferOwners.Reserve(Snapshot.BufferOwners.Num());
+	for (const TWeakObjectPtr<UFEMFXMeshComponent>& Owner : Snapshot.BufferOwners)
+	{
+		BufferOwners.Add(Owner.Get());
+	}
+
+	TArray<AMD::FmTetMeshBuffer*> NewBuffers;
+	TArray<AMD::FmRigidBody*> NewRigidBodies;
+	if (!DeserializeScene(AMDFXSceneBuffer, Snapshot.Data.GetData(), BufferOwners.Num(), SnapshotRigidBodies.Num(), NewBuffers, NewRigidBodies))
+	{
+		UE_LOG(FEMLog, Error, TEXT("FEM scene %s could not restore snapshot %d"), *Name, Snapshot.Id);
+		return false;
+	}
+
+	RebindDeserializedObjects(BufferOwners, NewBuffers, SnapshotRigidBodies, NewRigidBodies);
+
+	PendingGrowFlags = 0;
+
+	// The state jumped, show it without blending from where the meshes were before
+	for (UFEMFXMeshComponent* Component : BufferOwners)
+	{
+		Component->UpdateSceneProxy();
+		Component->ResetRenderInterpolation();
+	}
+
+	return true;
 }
 
 bool AFEMFXScene::AllocateNewMesh(UFEMFXMeshComponent* meshComponent)
@@ -97,31 +380,48 @@ bool AFEMFXScene::AllocateNewMesh(UFEMFXMeshComponent* meshComponent)
 		return false;
 	}
 
+	WaitForAsyncUpdate();
+
 	AMD::uint BufferId = AMD::FmAddTetMeshBufferToScene(AMDFXSceneBuffer, meshComponent->GetTetMeshBuffer());
 
+	AMD::FmTetMeshBufferBounds Bounds;
+	if (BufferId == FM_INVALID_ID && bGrowOnOverflow && meshComponent->ComputeTetMeshBufferBounds(Bounds))
+	{
+		// Not known which limit was hit, so make room for this buffer in all of them
+		MaxTetMeshBuffers = GrowCapacity(MaxTetMeshBuffers, GrowthFactor, m_ComponentsAllocated.Num() + 1);
+		MaxTetMeshes = GrowCapacity(MaxTetMeshes, GrowthFactor, (int64)MaxTetMeshes + Bounds.maxTetMeshes);
+		MaxVerts = GrowCapacity(MaxVerts, GrowthFactor, (int64)MaxVerts + Bounds.maxVerts);
+		MaxTetMeshBufferFeatures = FMath::Max<int32>(MaxTetMeshBufferFeatures, FMath::Max3(Bounds.maxVerts, Bounds.numTets, Bounds.maxExteriorFaces));
+
+		if (RecreateScene())
+		{
+			BufferId = AMD::FmAddTetMeshBufferToScene(AMDFXSceneBuffer, meshComponent->GetTetMeshBuffer());
+		}
+	}
+
 	if (BufferId == FM_INVALID_ID)
 	{
+		UE_LOG(FEMLog, Warning, TEXT("FEM scene %s is full, %s will not be simulated"), *Name, *meshComponent->GetName());
 		return false;
 	}
 
 	m_ComponentsAllocated.Push(meshComponent);
+	ComponentsByBufferId.Add(BufferId, meshComponent);
 
 	meshComponent->SceneBufferIndex = m_ComponentsAllocated.Num() - 1;
 
-	UpdateSimData();
+	if (AppliedSolveQualityScale < 1.0f)
+	{
+		meshComponent->SetSolveIterationScale(AppliedSolveQualityScale, MinUnconstrainedSolveIterations);
+	}
+
+	meshComponent->UpdateSceneProxy();
 
 	return true;
 }
 
-void AFEMFXScene::Initialize()
+AMD::FmSceneSetupParams AFEMFXScene::MakeSceneSetupParams() const
 {
-
-	if (bIsInitialized)
-		return;
-
-	AMD::SampleInitTaskSystem(NumWorkerThreads);
-	NumWorkerThreads = AMD::SampleGetTaskSystemNumThreads();
-
 	AMD::FmSceneSetupParams sceneParams;
 	sceneParams.maxTetMeshBuffers = MaxTetMeshBuffers;
 	sceneParams.maxTetMeshes = MaxTetMeshes;
@@ -136,31 +436,45 @@ void AFEMFXScene::Initialize()
 	sceneParams.maxBroadPhasePairs = MaxBroadPhasePairs;
 	sceneParams.maxRigidBodyBroadPhasePairs = MaxUserBroadPhasePairs;
 	sceneParams.maxSceneVerts = MaxVerts;
-    sceneParams.maxTetMeshBufferFeatures = 16384;
+    sceneParams.maxTetMeshBufferFeatures = MaxTetMeshBufferFeatures;
 	sceneParams.numWorkerThreads = NumWorkerThreads;  // Must match number of threads used by task scheduler
 
-    sceneParams.maxConstraintSolverDataSize = 100000000;
+    sceneParams.maxConstraintSolverDataSize = MaxConstraintSolverDataSize;
 
-	AMDFXSceneBuffer = AMD::FmCreateScene(sceneParams);
+	return sceneParams;
+}
 
-    AMD::FmTaskSystemCallbacks taskSystemCallbacks;
+void AFEMFXScene::Initialize()
+{
 
-    taskSystemCallbacks.SetCallbacks(
-        AMD::SampleGetTaskSystemNumThreads,
-        AMD::SampleGetTaskSystemWorkerIndex,
-        AMD::SampleAsyncTask,
-        AMD::SampleCreateSyncEvent,
-        AMD::SampleDestroySyncEvent,
-        AMD::SampleWaitForSyncEvent,
-        AMD::SampleTriggerSyncEvent
-#if !FM_ASYNC_THREADING
-        SampleCreateTaskWaitCounter,
-        SampleWaitForTaskWaitCounter,
-        SampleDestroyTaskWaitCounter,
-        SampleSubmitTask,
-        SampleParallelFor
-#endif
-    );
+	if (bIsInitialized)
+		return;
+
+	NumWorkerThreads = FFEMModule::Get().AcquireTaskSystem();
+
+	if (bCalibrateWorkerThreads && FFEMModule::Get().GetCalibratedWorkerThreads() == 0)
+	{
+		CalibrateWorkerThreads();
+	}
+
+	if (bAutoSizeCapacities)
+	{
+		ComputeAutoCapacities();
+	}
+
+	AMD::FmSceneSetupParams sceneParams = MakeSceneSetupParams();
+
+	if (bAutoSizeCapacities)
+	{
+		// Estimate from the capacities just computed, which already include the headroom
+		MaxConstraintSolverDataSize = AMD::FmEstimateSceneConstraintSolverDataSize(sceneParams);
+		sceneParams.maxConstraintSolverDataSize = MaxConstraintSolverDataSize;
+	}
+
+	AMDFXSceneBuffer = AMD::FmCreateScene(sceneParams);
+
+	UE_LOG(FEMLog, Log, TEXT("FEM scene %s created: %llu bytes, %llu bytes of solver data"),
+		*Name, (uint64)AMD::FmGetSceneSize(*AMDFXSceneBuffer), (uint64)MaxConstraintSolverDataSize);
 
     if (minPlaneConstraint.X == 0.0f && minPlaneConstraint.Y == 0.0f && minPlaneConstraint.Z == 0.0f
         && maxPlaneConstraint.X == 0.0f && maxPlaneConstraint.Y == 0.0f && maxPlaneConstraint.Z == 0.0f)
@@ -208,11 +522,98 @@ void AFEMFXScene::Initialize()
 	collisionReport.volumeContactBuffer = nullptr;
 
     AMD::FmSetSceneControlParams(AMDFXSceneBuffer, params);
-    AMD::FmSetSceneTaskSystemCallbacks(AMDFXSceneBuffer, taskSystemCallbacks);
+    SetSceneTaskSystemCallbacks(AMDFXSceneBuffer);
+
+	AuthoredControlParams = AMD::FmGetSceneControlParams(*AMDFXSceneBuffer);
 
 	bIsInitialized = true;
 }
 
+void AFEMFXScene::ComputeAutoCapacities()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_ComputeAutoCapacities);
+
+	int32 NumActors = 0;
+	int64 NumBuffers = 0;
+	int64 NumMeshes = 0;
+	int64 NumVerts = 0;
+	int64 NumRigidBodies = 0;
+	int64 NumGlueConstraints = 0;
+	int64 NumPlaneConstraints = 0;
+	int64 NumAngleConstraints = 0;
+	int64 MaxFeatures = 0;
+
+	TArray<AActor*> ActorsFound;
+	UGameplayStatics::GetAllActorsOfClass(this, AFEMActor::StaticClass(), ActorsFound);
+
+	TArray<UFEMFXMeshComponent*> Components;
+	for (AActor* Found : ActorsFound)
+	{
+		AFEMActor* Actor = Cast<AFEMActor>(Found);
+
+		// Same rule PreFEMLoad uses to pick the scene an actor joins
+		const FString& TargetName = Actor->bOverride_FEMScene ? Actor->SceneName : FString(TEXT("Default"));
+		if (TargetName != Name)
+			continue;
+
+		NumActors++;
+		NumRigidBodies += Actor->FEMResource.RigidBodies.Num();
+		NumGlueConstraints += Actor->FEMResource.GlueConstraints.Num();
+		NumPlaneConstraints += Actor->FEMResource.PlaneConstraints.Num();
+		NumAngleConstraints += Actor->FEMResource.AngleConstraints.Num();
+
+		Actor->GetComponents(Components);
+		for (UFEMFXMeshComponent* Component : Components)
+		{
+			AMD::FmTetMeshBufferBounds Bounds;
+			if (!Component->AddToSimulation || !Component->ComputeTetMeshBufferBounds(Bounds))
+				continue;
+
+			NumBuffers++;
+			NumMeshes += Bounds.maxTetMeshes;
+			NumVerts += Bounds.maxVerts;
+			MaxFeatures = FMath::Max<int64>(MaxFeatures, FMath::Max3(Bounds.maxVerts, Bounds.numTets, Bounds.maxExteriorFaces));
+		}
+	}
+
+	if (NumBuffers == 0)
+	{
+		UE_LOG(FEMLog, Log, TEXT("FEM scene %s: no FEM meshes found to size from, keeping the authored capacities"), *Name);
+		return;
+	}
+
+	const float Scale = 1.0f + FMath::Max(CapacityHeadroom, 0.0f);
+	auto WithHeadroom = [Scale](int64 Count)
+	{
+		return (int32)FMath::Min<int64>((int64)FMath::CeilToDouble(Count * (double)Scale), MAX_int32);
+	};
+
+	MaxTetMeshBuffers = WithHeadroom(NumBuffers);
+	MaxTetMeshes = WithHeadroom(NumMeshes);
+	MaxVerts = WithHeadroom(NumVerts);
+	MaxTetMeshBufferFeatures = WithHeadroom(MaxFeatures);
+	MaxRigidBodies = WithHeadroom(NumRigidBodies);
+	MaxGlueConstraints = WithHeadroom(NumGlueConstraints);
+	MaxPlaneConstraints = WithHeadroom(NumPlaneConstraints);
+	MaxRigidBodyAngleConstraints = WithHeadroom(NumAngleConstraints);
+
+	// Contacts and pairs depend on how the level plays out, so scale them from the geometry and keep the authored values as a ceiling
+	MaxDeformationConstraints = FMath::Min(MaxDeformationConstraints, MaxTetMeshBuffers * 64);
+	MaxDistanceContacts = FMath::Min(MaxDistanceContacts, WithHeadroom(NumVerts * 4));
+	MaxVolumeContactVerts = FMath::Min(MaxVolumeContactVerts, WithHeadroom(NumVerts * 2));
+	MaxBroadPhasePairs = FMath::Min(MaxBroadPhasePairs, WithHeadroom((NumMeshes + NumRigidBodies) * 8));
+	MaxVolumeContacts = FMath::Min(MaxVolumeContacts, MaxBroadPhasePairs);
+	MaxUserBroadPhasePairs = FMath::Min(MaxUserBroadPhasePairs, WithHeadroom(NumRigidBodies * 8));
+
+	UE_LOG(FEMLog, Log, TEXT("FEM scene %s sized from %d actors with %.0f%% headroom: %d/%lld buffers, %d/%lld meshes, %d/%lld verts, %d/%lld features per buffer, %d/%lld rigid bodies, %d/%lld glue, %d/%lld plane, %d/%lld angle constraints"),
+		*Name, NumActors, (Scale - 1.0f) * 100.0f,
+		MaxTetMeshBuffers, NumBuffers, MaxTetMeshes, NumMeshes, MaxVerts, NumVerts, MaxTetMeshBufferFeatures, MaxFeatures,
+		MaxRigidBodies, NumRigidBodies, MaxGlueConstraints, NumGlueConstraints, MaxPlaneConstraints, NumPlaneConstraints,
+		MaxRigidBodyAngleConstraints, NumAngleConstraints);
+	UE_LOG(FEMLog, Log, TEXT("FEM scene %s contact capacities: %d distance contacts, %d volume contacts, %d volume contact verts, %d broad phase pairs, %d rigid body pairs, %d deformation constraints"),
+		*Name, MaxDistanceContacts, MaxVolumeContacts, MaxVolumeContactVerts, MaxBroadPhasePairs, MaxUserBroadPhasePairs, MaxDeformationConstraints);
+}
+
 void AFEMFXScene::RemoveActor(AFEMActor* actor)
 {
 	for (int i = 0; i < actor->MeshComponents.Num(); i++)
@@ -228,10 +629,14 @@ void AFEMFXScene::RemoveActor(AFEMActor* actor)
 
 void AFEMFXScene::FreeComponent(UFEMFXMeshComponent* comp)
 {
+	WaitForAsyncUpdate();
+
 	if (AMDFXSceneBuffer)
 	{
 		if (IsValid(comp))
 		{
+			ComponentsByBufferId.Remove(comp->GetBufferId());
+
 			AMD::FmRemoveTetMeshBufferFromScene(AMDFXSceneBuffer, comp->GetBufferId());
 
 			if (comp->GetTetMeshBuffer())
@@ -242,11 +647,14 @@ void AFEMFXScene::FreeComponent(UFEMFXMeshComponent* comp)
 	}
 	if (comp) {
 		m_ComponentsAllocated.Remove(comp);
+		PendingCollisions.Remove(comp);
 	}
 }
 
 void AFEMFXScene::SetAllSleeping()
 {
+    WaitForAsyncUpdate();
+
     if (AMDFXSceneBuffer)
     {
         AMD::FmSetAllSceneObjectsSleeping(AMDFXSceneBuffer);
@@ -255,6 +663,8 @@ void AFEMFXScene::SetAllSleeping()
 
 void AFEMFXScene::CreateSleepingGroup(const TArray<AActor*>& Actors)
 {
+    WaitForAsyncUpdate();
+
     if (AMDFXSceneBuffer)
     {
         TArray<uint32> TetMeshIds;
@@ -280,272 +690,919 @@ void AFEMFXScene::CreateSleepingGroup(const TArray<AActor*>& Actors)
 
 void AFEMFXScene::SetGroupsCanCollide(int i, int j, bool canCollide)
 {
+    WaitForAsyncUpdate();
+
     if (AMDFXSceneBuffer)
     {
         AMD::FmSetGroupsCanCollide(AMDFXSceneBuffer, (AMD::uint)i, (AMD::uint)j, canCollide);
     }
 }
 
-void AFEMFXScene::AddToResetList(AActor* actor)
+void AFEMFXScene::SetActiveWorkerThreads(int32 NumThreads)
 {
-	//FEMActors.Add(actor);
+	FFEMModule::Get().SetTaskSystemActiveThreads(NumThreads);
 }
 
-void AFEMFXScene::AddRigidBodyToScene(AMD::FmRigidBody* inRigidBody)
+int32 AFEMFXScene::GetActiveWorkerThreads() const
 {
-    AMD::FmAddRigidBodyToScene(AMDFXSceneBuffer, inRigidBody);
+	return FFEMModule::Get().GetTaskSystemActiveThreads();
 }
 
-void AFEMFXScene::FreeScene()
+/** Builds the calibration block, resting just above the floor and moving down so it hits it during the warm up steps */
+static AMD::FmTetMeshBuffer* CreateCalibrationBlock(AMD::FmTetMeshBufferBounds& OutBounds)
 {
-	if (AMDFXSceneBuffer)
-	{
-		for (int i = 0; i < m_ComponentsAllocated.Num(); ++i)
-		{
-			UFEMFXMeshComponent* comp = m_ComponentsAllocated[i];
+	const int NumCubes = FEMCalibrationBlockCubes;
 
-			if (comp && comp->GetTetMeshBuffer())
-			{
-                FmDestroyTetMeshBuffer(comp->GetTetMeshBuffer());
-			}
-		}
+	AMD::uint NumVerts;
+	AMD::uint NumTets;
+	ProceduralMeshHelper::GetBlockMeshCounts(&NumVerts, &NumTets, NumCubes, NumCubes, NumCubes);
 
-        FmDestroyScene(AMDFXSceneBuffer);
+	std::vector<AMD::uint>* BlockIncidentTets = new std::vector<AMD::uint>[NumVerts];
+	AMD::FmArray<unsigned int>* VertIncidentTets = new AMD::FmArray<unsigned int>[NumVerts];
+	AMD::FmVector3* RestPositions = new AMD::FmVector3[NumVerts];
+	AMD::FmTetVertIds* TetVertIds = new AMD::FmTetVertIds[NumTets];
+	AMD::FmFractureGroupCounts* FractureGroupCounts = new AMD::FmFractureGroupCounts[NumTets];
+	AMD::uint* TetFractureGroupIds = new AMD::uint[NumTets];
 
-		AMDFXSceneBuffer = nullptr;
-	}
-}
+	ProceduralMeshHelper::CreateBlockMesh(BlockIncidentTets, NumCubes, NumCubes, NumCubes);
+	ProceduralMeshHelper::InitBlockVerts(RestPositions, TetVertIds, false,
+		FEMCalibrationCubeSize, FEMCalibrationCubeSize, FEMCalibrationCubeSize, NumCubes, NumCubes, NumCubes, 1.0f);
 
-void AFEMFXScene::Destroyed()
-{
-	Super::Destroyed();
+	for (AMD::uint VertIdx = 0; VertIdx < NumVerts; VertIdx++)
+	{
+		for (AMD::uint TetId : BlockIncidentTets[VertIdx])
+		{
+			VertIncidentTets[VertIdx].Add(TetId);
+		}
+	}
 
-	FreeScene();
+	AMD::FmComputeTetMeshBufferBounds(&OutBounds, FractureGroupCounts, TetFractureGroupIds,
+		VertIncidentTets, TetVertIds, nullptr, NumVerts, NumTets, false);
+
+	AMD::FmTetMeshBufferSetupParams TetMeshParams;
+	TetMeshParams.numVerts = OutBounds.numVerts;
+	TetMeshParams.maxVerts = OutBounds.maxVerts;
+	TetMeshParams.numTets = OutBounds.numTets;
+	TetMeshParams.maxVertAdjacentVerts = OutBounds.maxVertAdjacentVerts;
+	TetMeshParams.numVertIncidentTets = OutBounds.numVertIncidentTets;
+	TetMeshParams.maxExteriorFaces = OutBounds.maxExteriorFaces;
+	TetMeshParams.maxTetMeshes = OutBounds.maxTetMeshes;
+	TetMeshParams.enablePlasticity = false;
+	TetMeshParams.enableFracture = false;
+	TetMeshParams.isKinematic = false;
+
+	AMD::FmTetMesh* TetMesh;
+	AMD::FmTetMeshBuffer* TetMeshBuffer = AMD::FmCreateTetMeshBuffer(TetMeshParams, FractureGroupCounts, TetFractureGroupIds, &TetMesh);
+
+	AMD::FmMatrix3 Rotation = AMD::FmInitMatrix3(AMD::FmInitVector3(1, 0, 0), AMD::FmInitVector3(0, 1, 0), AMD::FmInitVector3(0, 0, 1));
+	AMD::FmInitVertState(TetMesh, RestPositions, Rotation, AMD::FmInitVector3(0.0f, 0.05f, 0.0f), 1.0f, AMD::FmInitVector3(0.0f, -2.0f, 0.0f));
+	AMD::FmSetCollisionGroup(TetMesh, 0);
+	AMD::FmInitTetState(TetMesh, TetVertIds, AMD::FmTetMaterialParams(), 0.6f);
+	AMD::FmComputeMeshConstantMatrices(TetMesh);
+	AMD::FmSetMassesFromRestDensities(TetMesh);
+	AMD::FmInitConnectivity(TetMesh, VertIncidentTets);
+	AMD::FmFinishTetMeshInit(TetMesh);
+
+	delete[] BlockIncidentTets;
+	delete[] VertIncidentTets;
+	delete[] RestPositions;
+	delete[] TetVertIds;
+	delete[] FractureGroupCounts;
+	delete[] TetFractureGroupIds;
+
+	return TetMeshBuffer;
 }
 
-// Called when the game starts or when spawned
-void AFEMFXScene::BeginPlay()
+int32 AFEMFXScene::CalibrateWorkerThreads()
 {
-	Super::BeginPlay();
-}
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_CalibrateWorkerThreads);
 
-void AFEMFXScene::EndPlay(const EEndPlayReason::Type EndPlayReason)
-{
-	Super::EndPlay(EndPlayReason);
+	WaitForAsyncUpdate();
 
-	FreeScene();
-	//RemoveFromRoot();
-}
+	FFEMModule& Module = FFEMModule::Get();
+	const int32 MaxThreads = Module.AcquireTaskSystem();
 
-void AFEMFXScene::Tick(float DeltaTime)
-{
+	// Every count from 2 while they are few, then steps of about a quarter so large core counts don't take long
+	TArray<int32> Counts;
+	for (int32 Count = 2; Count < MaxThreads; Count += FMath::Max(Count / 4, 1))
+	{
+		Counts.Add(Count);
+	}
+	Counts.Add(FMath::Max(MaxThreads, 2));
 
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_Tick);
+	int32 BestCount = 0;
+	double BestEnergy = 0.0;
+	const float Timestep = 1.0f / 60.0f;
 
-	Super::Tick(DeltaTime);
+	for (int32 Count : Counts)
+	{
+		Module.SetTaskSystemActiveThreads(Count);
+		if (Module.GetTaskSystemActiveThreads() != Count)
+		{
+			UE_LOG(FEMLog, Warning, TEXT("FEM task system can't change its active thread count, skipping worker calibration"));
+			BestCount = 0;
+			break;
+		}
 
-	if (!bAllowTick)
-		return;
+		// A fresh scene and block for every count so each measures the same part of the simulation
+		AMD::FmTetMeshBufferBounds Bounds;
+		AMD::FmTetMeshBuffer* Block = CreateCalibrationBlock(Bounds);
+
+		AMD::FmSceneSetupParams SceneParams = MakeSceneSetupParams();
+		SceneParams.maxTetMeshBuffers = 1;
+		SceneParams.maxTetMeshes = Bounds.maxTetMeshes;
+		SceneParams.maxSceneVerts = Bounds.maxVerts;
+		SceneParams.maxTetMeshBufferFeatures = FMath::Max3(Bounds.maxVerts, Bounds.numTets, Bounds.maxExteriorFaces);
+		SceneParams.numWorkerThreads = MaxThreads;
+		SceneParams.maxConstraintSolverDataSize = AMD::FmEstimateSceneConstraintSolverDataSize(SceneParams);
+
+		AMD::FmScene* Scene = AMD::FmCreateScene(SceneParams);
+
+		AMD::FmSceneControlParams ControlParams;
+		ControlParams.collisionPlanes.minX = -1000.0f;
+		ControlParams.collisionPlanes.minY = 0.0f;
+		ControlParams.collisionPlanes.minZ = -1000.0f;
+		ControlParams.collisionPlanes.maxX = 1000.0f;
+		ControlParams.collisionPlanes.maxY = 1000.0f;
+		ControlParams.collisionPlanes.maxZ = 1000.0f;
+		ControlParams.rigidBodiesExternal = false;
+		AMD::FmSetSceneControlParams(Scene, ControlParams);
+		SetSceneTaskSystemCallbacks(Scene);
+
+		AMD::FmAddTetMeshBufferToScene(Scene, Block);
+
+		// The fastest step is the one least disturbed by the rest of the process
+		double StepSeconds = MAX_dbl;
+		for (int32 StepIdx = 0; StepIdx < FEMCalibrationWarmupSteps + FEMCalibrationMeasuredSteps; StepIdx++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			AMD::FmUpdateScene(Scene, Timestep);
+			if (StepIdx >= FEMCalibrationWarmupSteps)
+			{
+				StepSeconds = FMath::Min(StepSeconds, FPlatformTime::Seconds() - StartTime);
+			}
+		}
 
-	if (!bIsInitialized)
-		Initialize();
+		AMD::FmDestroyScene(Scene);
+		AMD::FmDestroyTetMeshBuffer(Block);
 
-	timeElapsed += DeltaTime;
+		double Energy = StepSeconds * (FMath::Max(CalibrationBasePower, 0.0f) + Count);
+		UE_LOG(FEMLog, Log, TEXT("FEM calibration: %d threads, %.3f ms per step"), Count, StepSeconds * 1000.0);
 
-	if (timeElapsed < frameTime)
-	{
-		return;
+		if (BestCount == 0 || Energy < BestEnergy)
+		{
+			BestCount = Count;
+			BestEnergy = Energy;
+		}
 	}
-	
-	float timestep = 1.0f / 60.0f;
-    int numSteps = 1;
 
-    numSteps = timeElapsed / timestep;
+	if (BestCount > 0)
+	{
+		UE_LOG(FEMLog, Log, TEXT("FEM calibration picked %d worker threads"), BestCount);
+		Module.SetCalibratedWorkerThreads(BestCount);
+	}
+	else
+	{
+		Module.SetTaskSystemActiveThreads(0);
+	}
 
-    timeElapsed -= numSteps * timestep;
+	Module.ReleaseTaskSystem();
 
-    if (numSteps > 2)  // limit maximum steps to avoid feedback loop
-    {
-        numSteps = 2;
-        timeElapsed = 0.0f;
-    }
+	return BestCount;
+}
 
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateScene);
-	for (int stepIdx = 0; stepIdx < numSteps; stepIdx++)
-	{
-        FmUpdateScene(AMDFXSceneBuffer, timestep);
+void AFEMFXScene::AddToResetList(AActor* actor)
+{
+	//FEMActors.Add(actor);
+}
+
+void AFEMFXScene::AddRigidBodyToScene(AMD::FmRigidBody* inRigidBody)
+{
+    WaitForAsyncUpdate();
 
-        for (int i = 0; i < FEMActors.Num(); ++i)
+    AMD::uint RigidBodyId = AMD::FmAddRigidBodyToScene(AMDFXSceneBuffer, inRigidBody);
+
+    if (RigidBodyId == FM_INVALID_ID && bGrowOnOverflow)
+    {
+        MaxRigidBodies = GrowCapacity(MaxRigidBodies, GrowthFactor, SceneRigidBodies.Num() + 1);
+
+        if (RecreateScene())
         {
-            if (IsValid(FEMActors[i]))
-            {
-                FEMActors[i]->UpdateConstraints();
-            }
+            RigidBodyId = AMD::FmAddRigidBodyToScene(AMDFXSceneBuffer, inRigidBody);
         }
+    }
+
+    if (RigidBodyId == FM_INVALID_ID)
+    {
+        UE_LOG(FEMLog, Warning, TEXT("FEM scene %s is full, rigid body not added"), *Name);
+        return;
+    }
+
+    SceneRigidBodies.Add(inRigidBody);
+}
+
+void AFEMFXScene::RemoveRigidBodyFromScene(AMD::FmRigidBody* inRigidBody)
+{
+    WaitForAsyncUpdate();
+
+    if (AMDFXSceneBuffer && SceneRigidBodies.Remove(inRigidBody) > 0)
+    {
+        AMD::FmRemoveRigidBodyFromScene(AMDFXSceneBuffer, AMD::FmGetObjectId(*inRigidBody));
+    }
+}
+
+void AFEMFXScene::FreeScene()
+{
+	WaitForAsyncUpdate();
+	bAsyncUpdateInFlight = false;
 
-        UpdateRenderingDataFromFracture();
+	if (AMDFXSceneBuffer)
+	{
+		for (int i = 0; i < m_ComponentsAllocated.Num(); ++i)
+		{
+			UFEMFXMeshComponent* comp = m_ComponentsAllocated[i];
+
+			if (comp && comp->GetTetMeshBuffer())
+			{
+                FmDestroyTetMeshBuffer(comp->GetTetMeshBuffer());
+			}
+		}
+
+        FmDestroyScene(AMDFXSceneBuffer);
+
+		AMDFXSceneBuffer = nullptr;
+
+		FFEMModule::Get().ReleaseTaskSystem();
+
+		ComponentsByBufferId.Empty();
+		PendingCollisions.Empty();
+		SceneRigidBodies.Empty();
+		PendingGrowFlags = 0;
+		TetMeshMotion.Empty();
+		ChangedComponents.Empty();
+		Snapshots.Empty();
+		InitialSnapshot = FFEMSceneSnapshot();
+		bInitialSnapshotPending = true;
 	}
+}
 
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateSimData);
-	UpdateSimData();
+void AFEMFXScene::Destroyed()
+{
+	Super::Destroyed();
 
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_CollisionCallback);
-    AMD::FmCollisionReport& CollisionReport = FmGetSceneCollisionReportRef(AMDFXSceneBuffer);
-	if (CollisionReport.numDistanceContacts.val > 0)
+	FreeScene();
+}
+
+// Called when the game starts or when spawned
+void AFEMFXScene::BeginPlay()
+{
+	Super::BeginPlay();
+}
+
+void AFEMFXScene::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	FreeScene();
+	//RemoveFromRoot();
+}
+
+void AFEMFXScene::Tick(float DeltaTime)
+{
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_Tick);
+
+	Super::Tick(DeltaTime);
+
+	if (!bAllowTick)
+		return;
+
+	if (!bIsInitialized)
+		Initialize();
+
+	// Consume the step started last frame before touching the scene again
+	bool bHasNewResults = false;
+	FrameUpdateSeconds = 0.0;
+	if (bAsyncUpdateInFlight)
 	{
-		for (AMD::uint i = 0; i < CollisionReport.numDistanceContacts.val; ++i)
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_WaitForAsyncUpdate);
+		WaitForAsyncUpdate();
+		bAsyncUpdateInFlight = false;
+
+		FrameUpdateSeconds += AsyncUpdateEndTime - AsyncUpdateStartTime;
+
+		FinishSceneStep();
+		bHasNewResults = true;
+	}
+
+	// Every actor placed in the level has loaded by the first Tick
+	if (bInitialSnapshotPending)
+	{
+		bInitialSnapshotPending = false;
+
+		if (bCaptureInitialSnapshot && AMDFXSceneBuffer && WriteSnapshot(InitialSnapshot))
 		{
-			FEMCollision colA;
-			FEMCollision colB;
+			InitialSnapshot.Id = 0;
+		}
+	}
+
+	timeElapsed += DeltaTime;
+
+	float timestep = 1.0f / FMath::Clamp(SimulationRate, 10.0f, 240.0f);
+	int maxSteps = FMath::Max(FMath::FloorToInt(MaxSteps), 1);
+	if (bEnableBudgetGovernor)
+	{
+		maxSteps = FMath::Clamp(BudgetMaxSteps, 1, maxSteps);
+	}
+	int numSteps = FMath::FloorToInt(timeElapsed / timestep);
+
+	if (numSteps > maxSteps)  // limit maximum steps to avoid feedback loop
+	{
+		// Keep the partial step so interpolation stays continuous, only whole steps beyond the limit are dropped
+		numSteps = maxSteps;
+		timeElapsed = FMath::Fmod(timeElapsed, timestep);
+	}
+	else
+	{
+		timeElapsed -= numSteps * timestep;
+	}
+
+	// When running asynchronously only the last step of the frame overlaps, earlier ones still run inline
+	int numSyncSteps = bAsyncUpdate ? FMath::Max(numSteps - 1, 0) : numSteps;
+
+	{
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateScene);
 
-			UFEMFXMeshComponent* compA = nullptr;
-			UFEMFXMeshComponent* compB = nullptr;
+		// The game thread blocks on these steps, so their tasks go ahead of any background FEM work
+		AMD::SampleSetThreadTaskPriority(AMD::SAMPLE_TASK_PRIORITY_CRITICAL, 0);
 
-			for (int j = 0; j < m_ComponentsAllocated.Num(); ++j)
+		for (int stepIdx = 0; stepIdx < numSyncSteps; stepIdx++)
+		{
+			// Interpolation blends between the last two steps, so remember where the last step of this frame starts
+			if (bInterpolateRendering && numSteps > 1 && stepIdx == numSteps - 1)
 			{
-				AMD::FmTetMesh* tetMeshA = AMD::FmGetTetMesh(*AMDFXSceneBuffer, CollisionReport.distanceContactBuffer[i].objectIdA);
-				AMD::FmTetMesh* tetMeshB = AMD::FmGetTetMesh(*AMDFXSceneBuffer, CollisionReport.distanceContactBuffer[i].objectIdB);
-				
-				if (tetMeshA == nullptr || tetMeshB == nullptr)
-					continue;
-
-				if (m_ComponentsAllocated[j]->GetBufferId() == FmGetTetMeshBufferId(*tetMeshA))
-				{
-					compA = m_ComponentsAllocated[j];
-					AMD::FmVector3 temp = CollisionReport.distanceContactBuffer[i].normal;
-
-					uint32 tetId = CollisionReport.distanceContactBuffer[i].tetIdA;
-                    AMD::FmTetVertIds tetVertIds = FmGetTetVertIds(*tetMeshA, tetId);
-					AMD::FmVector3 tempPos1 = FmGetVertPosition(*tetMeshA, tetVertIds.ids[0]);
-					AMD::FmVector3 tempPos2 = FmGetVertPosition(*tetMeshA, tetVertIds.ids[1]);
-					AMD::FmVector3 tempPos3 = FmGetVertPosition(*tetMeshA, tetVertIds.ids[2]);
-					AMD::FmVector3 tempPos4 = FmGetVertPosition(*tetMeshA, tetVertIds.ids[3]);
-
-					float* baryPos = CollisionReport.distanceContactBuffer[i].posBaryA;
-
-					AMD::FmVector3 tempPos = tempPos1 * baryPos[0] + tempPos2 * baryPos[1] + tempPos3 * baryPos[2] + tempPos4 * baryPos[3];
-
-					colA.Normal = ConvertFEMFXVectorToUnreal(temp);
-					colA.Position = ConvertFEMFXVectorToUnreal(tempPos) * 100;
-					colA.TetInfo = CreateTetInfo(tetMeshA, tetId);
-					colA.BarCentricPositions.AddDefaulted(4);
-					colA.BarCentricPositions[0] = baryPos[0];
-					colA.BarCentricPositions[1] = baryPos[1];
-					colA.BarCentricPositions[2] = baryPos[2];
-					colA.BarCentricPositions[3] = baryPos[3];
-				}
-				else if (m_ComponentsAllocated[j]->GetBufferId() == FmGetTetMeshBufferId(*tetMeshB))
-				{
-					compB = m_ComponentsAllocated[j];
-					AMD::FmVector3 temp = CollisionReport.distanceContactBuffer[i].normal;
-					
-					uint32 tetId = CollisionReport.distanceContactBuffer[i].tetIdB;
-                    AMD::FmTetVertIds tetVertIds = FmGetTetVertIds(*tetMeshB, tetId);
-                    AMD::FmVector3 tempPos1 = FmGetVertPosition(*tetMeshB, tetVertIds.ids[0]);
-                    AMD::FmVector3 tempPos2 = FmGetVertPosition(*tetMeshB, tetVertIds.ids[1]);
-                    AMD::FmVector3 tempPos3 = FmGetVertPosition(*tetMeshB, tetVertIds.ids[2]);
-                    AMD::FmVector3 tempPos4 = FmGetVertPosition(*tetMeshB, tetVertIds.ids[3]);
-
-					float* baryPos = CollisionReport.distanceContactBuffer[i].posBaryB;
-
-					AMD::FmVector3 tempPos = tempPos1 * baryPos[0] + tempPos2 * baryPos[1] + tempPos3 * baryPos[2] + tempPos4 * baryPos[3];
-
-					colB.Normal = ConvertFEMFXVectorToUnreal(temp);
-					colB.Position = ConvertFEMFXVectorToUnreal(tempPos) * 100;
-					colB.TetInfo = CreateTetInfo(tetMeshB, tetId);
-					colB.BarCentricPositions.AddDefaulted(4);
-					colB.BarCentricPositions[0] = baryPos[0];
-					colB.BarCentricPositions[1] = baryPos[1];
-					colB.BarCentricPositions[2] = baryPos[2];
-					colB.BarCentricPositions[3] = baryPos[3];
-				}
-				if (compA != nullptr && compB != nullptr)
-					break;
+				CaptureStepStartPositions();
 			}
-			if (compA != nullptr) 
+
+			double UpdateStartTime = FPlatformTime::Seconds();
+			FmUpdateScene(AMDFXSceneBuffer, timestep);
+			FrameUpdateSeconds += FPlatformTime::Seconds() - UpdateStartTime;
+
+			FinishSceneStep();
+			bHasNewResults = true;
+		}
+
+		AMD::SampleSetThreadTaskPriority(AMD::SAMPLE_TASK_PRIORITY_NORMAL, 0);
+	}
+
+	if (bHasNewResults)
+	{
+		{
+			QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateSimData);
+			UpdateSimData();
+		}
+
+		DispatchCollisionEvents();
+	}
+
+	// Results of the steps above have been consumed, so this is the one point in the frame where the scene can be swapped
+	if (PendingGrowFlags != 0)
+	{
+		GrowForWarnings(PendingGrowFlags);
+		PendingGrowFlags = 0;
+	}
+
+	if (bInterpolateRendering)
+	{
+		UpdateRenderInterpolation(timeElapsed / timestep);
+	}
+
+	// Changes solver and material params, so it has to run while no step is in flight
+	UpdateBudgetGovernor(DeltaTime);
+
+	// Render data and contacts have been read, the scene may now be updated in the background
+	if (numSteps > numSyncSteps)
+	{
+		if (bInterpolateRendering && numSteps > 1)
+		{
+			CaptureStepStartPositions();
+		}
+
+		// Assume the next frame takes as long as this one
+		StartAsyncUpdate(timestep, DeltaTime);
+	}
+
+	UpdateTaskSystemPoolStats();
+}
+
+void AFEMFXScene::FinishSceneStep()
+{
+	for (int i = 0; i < FEMActors.Num(); ++i)
+	{
+		if (IsValid(FEMActors[i]))
+		{
+			FEMActors[i]->UpdateConstraints();
+		}
+	}
+
+	UpdateRenderingDataFromFracture();
+
+	if (bGrowOnOverflow)
+	{
+		AMD::FmWarningsReport& Warnings = AMD::FmGetSceneWarningsReportRef(AMDFXSceneBuffer);
+		PendingGrowFlags |= Warnings.flags.val & FEM_SCENE_CAPACITY_WARNING_FLAGS;
+		Warnings.flags.val &= ~FEM_SCENE_CAPACITY_WARNING_FLAGS;
+	}
+}
+
+void AFEMFXScene::GrowForWarnings(uint32 WarningFlags)
+{
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_TET_MESHES)
+		MaxTetMeshes = GrowCapacity(MaxTetMeshes, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_BROAD_PHASE_PAIRS)
+		MaxBroadPhasePairs = GrowCapacity(MaxBroadPhasePairs, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_RIGID_BODY_BROAD_PHASE_PAIRS)
+		MaxUserBroadPhasePairs = GrowCapacity(MaxUserBroadPhasePairs, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_DISTANCE_CONTACTS)
+		MaxDistanceContacts = GrowCapacity(MaxDistanceContacts, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_VOLUME_CONTACTS)
+		MaxVolumeContacts = GrowCapacity(MaxVolumeContacts, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_VOLUME_CONTACT_VERTS)
+		MaxVolumeContactVerts = GrowCapacity(MaxVolumeContactVerts, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_DEFORMATION_CONSTRAINTS)
+		MaxDeformationConstraints = GrowCapacity(MaxDeformationConstraints, GrowthFactor);
+	if (WarningFlags & FM_WARNING_FLAG_HIT_LIMIT_SCENE_CONSTRAINT_SOLVER_MEMORY)
+		MaxConstraintSolverDataSize = (size_t)FMath::CeilToDouble(MaxConstraintSolverDataSize * (double)GrowthFactor);
+
+	UE_LOG(FEMLog, Log, TEXT("FEM scene %s hit capacity limits (warning flags 0x%x), growing"), *Name, WarningFlags);
+
+	RecreateScene();
+}
+
+void AFEMFXScene::GetSerializedObjectOwners(TArray<UFEMFXMeshComponent*>& OutBufferOwners, TArray<AMD::FmRigidBody*>& OutRigidBodies)
+{
+	// Objects are serialized in id order, so the owners are listed the same way to match them up with the deserialized copies
+	SnapshotBufferIds.Reset();
+	for (const TPair<uint32, UFEMFXMeshComponent*>& Pair : ComponentsByBufferId)
+	{
+		SnapshotBufferIds.Add(Pair.Key);
+	}
+	SnapshotBufferIds.Sort();
+
+	OutBufferOwners.Reset(SnapshotBufferIds.Num());
+	for (uint32 BufferId : SnapshotBufferIds)
+	{
+		OutBufferOwners.Add(ComponentsByBufferId.FindChecked(BufferId));
+	}
+
+	// Appending keeps the output's allocation, assigning would reallocate whenever the count changes
+	OutRigidBodies.Reset(SceneRigidBodies.Num());
+	OutRigidBodies.Append(SceneRigidBodies);
+	OutRigidBodies.Sort([](const AMD::FmRigidBody& A, const AMD::FmRigidBody& B)
+	{
+		return AMD::FmGetObjectId(A) < AMD::FmGetObjectId(B);
+	});
+}
+
+bool AFEMFXScene::DeserializeScene(AMD::FmScene* TargetScene, const uint8_t* Serialized, int32 NumBufferOwners, int32 NumRigidBodies,
+	TArray<AMD::FmTetMeshBuffer*>& OutBuffers, TArray<AMD::FmRigidBody*>& OutRigidBodies)
+{
+	AMD::FmSerializedSceneCounts Counts;
+	AMD::FmGetSerializedSceneCounts(&Counts, Serialized);
+
+	if (Counts.numTetMeshBuffers != (AMD::uint)NumBufferOwners || Counts.numRigidBodies != (AMD::uint)NumRigidBodies)
+	{
+		UE_LOG(FEMLog, Error, TEXT("FEM scene %s: serialized data has %u buffers and %u rigid bodies, expected %d and %d"),
+			*Name, Counts.numTetMeshBuffers, Counts.numRigidBodies, NumBufferOwners, NumRigidBodies);
+		return false;
+	}
+
+	OutBuffers.SetNumZeroed(Counts.numTetMeshBuffers);
+	OutRigidBodies.SetNumZeroed(Counts.numRigidBodies);
+
+	if (!AMD::FmDeserializeScene(TargetScene, OutBuffers.GetData(), OutRigidBodies.GetData(), Serialized))
+	{
+		for (AMD::FmTetMeshBuffer* Buffer : OutBuffers)
+		{
+			if (Buffer)
+				AMD::FmDestroyTetMeshBuffer(Buffer);
+		}
+		for (AMD::FmRigidBody* RigidBody : OutRigidBodies)
+		{
+			if (RigidBody)
+				AMD::FmDestroyRigidBody(RigidBody);
+		}
+		return false;
+	}
+
+	return true;
+}
+
+void AFEMFXScene::RebindDeserializedObjects(const TArray<UFEMFXMeshComponent*>& BufferOwners, const TArray<AMD::FmTetMeshBuffer*>& NewBuffers,
+	const TArray<AMD::FmRigidBody*>& OldRigidBodies, const TArray<AMD::FmRigidBody*>& NewRigidBodies)
+{
+	// Components and actors own their objects, hand them the copies and let them free the originals
+	ComponentsByBufferId.Reset();
+	for (int32 i = 0; i < BufferOwners.Num(); i++)
+	{
+		BufferOwners[i]->RebindTetMeshBuffer(NewBuffers[i]);
+		ComponentsByBufferId.Add(BufferOwners[i]->GetBufferId(), BufferOwners[i]);
+	}
+
+	TMap<AMD::FmRigidBody*, AMD::FmRigidBody*> RigidBodyMap;
+	for (int32 i = 0; i < OldRigidBodies.Num(); i++)
+	{
+		RigidBodyMap.Add(OldRigidBodies[i], NewRigidBodies[i]);
+	}
+	SceneRigidBodies = NewRigidBodies;
+
+	for (AFEMActor* Actor : FEMActors)
+	{
+		if (IsValid(Actor))
+		{
+			Actor->RebindSceneObjects(RigidBodyMap);
+		}
+	}
+
+	// Object ids are reassigned, so every mesh is treated as moved on the next update
+	TetMeshMotion.Reset();
+}
+
+bool AFEMFXScene::RecreateScene()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_RecreateScene);
+
+	WaitForAsyncUpdate();
+
+	if (!AMDFXSceneBuffer)
+		return false;
+
+	AMD::FmSceneSetupParams sceneParams = MakeSceneSetupParams();
+	if (bAutoSizeCapacities)
+	{
+		MaxConstraintSolverDataSize = FMath::Max(MaxConstraintSolverDataSize, AMD::FmEstimateSceneConstraintSolverDataSize(sceneParams));
+		sceneParams.maxConstraintSolverDataSize = MaxConstraintSolverDataSize;
+	}
+
+	size_t SerializedSize = 0;
+	uint8_t* Serialized = AMD::FmSerializeScene(&SerializedSize, *AMDFXSceneBuffer);
+	if (!Serialized)
+	{
+		UE_LOG(FEMLog, Error, TEXT("FEM scene %s could not be serialized for growing"), *Name);
+		return false;
+	}
+
+	TArray<UFEMFXMeshComponent*> BufferOwners;
+	TArray<AMD::FmRigidBody*> OldRigidBodies;
+	GetSerializedObjectOwners(BufferOwners, OldRigidBodies);
+
+	size_t OldSceneSize = AMD::FmGetSceneSize(*AMDFXSceneBuffer);
+
+	AMD::FmScene* NewScene = AMD::FmCreateScene(sceneParams);
+
+	TArray<AMD::FmTetMeshBuffer*> NewBuffers;
+	TArray<AMD::FmRigidBody*> NewRigidBodies;
+	bool bDeserialized = DeserializeScene(NewScene, Serialized, BufferOwners.Num(), OldRigidBodies.Num(), NewBuffers, NewRigidBodies);
+	FmAlignedFree(Serialized);
+
+	if (!bDeserialized)
+	{
+		UE_LOG(FEMLog, Error, TEXT("FEM scene %s could not be moved to a larger scene, keeping the current one"), *Name);
+		AMD::FmDestroyScene(NewScene);
+		return false;
+	}
+
+	// Settings held by the scene itself rather than by the serialized objects
+	AMD::FmSetSceneControlParams(NewScene, AMD::FmGetSceneControlParams(*AMDFXSceneBuffer));
+	SetSceneTaskSystemCallbacks(NewScene);
+	for (AMD::uint i = 0; i < 32; i++)
+	{
+		for (AMD::uint j = i; j < 32; j++)
+		{
+			AMD::FmSetGroupsCanCollide(NewScene, i, j, AMD::FmGroupsCanCollide(*AMDFXSceneBuffer, i, j));
+		}
+	}
+	FmGetSceneCollisionReportRef(NewScene) = FmGetSceneCollisionReportRef(AMDFXSceneBuffer);
+
+	AMD::FmDestroyScene(AMDFXSceneBuffer);
+	AMDFXSceneBuffer = NewScene;
+
+	RebindDeserializedObjects(BufferOwners, NewBuffers, OldRigidBodies, NewRigidBodies);
+
+	UE_LOG(FEMLog, Log, TEXT("FEM scene %s grown from %llu to %llu bytes: %d buffers, %d meshes, %d verts, %d rigid bodies, %d distance contacts, %d broad phase pairs, %llu bytes of solver data"),
+		*Name, (uint64)OldSceneSize, (uint64)AMD::FmGetSceneSize(*AMDFXSceneBuffer),
+		MaxTetMeshBuffers, MaxTetMeshes, MaxVerts, MaxRigidBodies, MaxDistanceContacts, MaxBroadPhasePairs, (uint64)MaxConstraintSolverDataSize);
+
+	return true;
+}
+
+void AFEMFXScene::StartAsyncUpdate(float Timestep, float ExpectedWaitSeconds)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_StartAsyncUpdate);
+
+	check(!bAsyncUpdateInFlight);
+
+	// FmUpdateScene() installs its own post-update callback, so set ours before every asynchronous step
+	AsyncUpdateEvent = AMD::SampleCreateSyncEvent();
+	AMD::FmSetPostSceneUpdateCallback(AMDFXSceneBuffer, &AFEMFXScene::PostAsyncSceneUpdate, this);
+
+	// Deleted by the library when the update completes
+	AMD::FmTaskDataUpdateScene* TaskData = new AMD::FmTaskDataUpdateScene(AMDFXSceneBuffer, Timestep);
+
+	bAsyncUpdateInFlight = true;
+	AsyncUpdateStartTime = FPlatformTime::Seconds();
+
+	// The step's tasks inherit the deadline. Those submitted or taken by a worker close to it run as critical, so the rest of the step goes first.
+	uint64_t DeadlineNs = AMD::SampleGetTaskSystemTimeNs() + (uint64_t)(FMath::Max(ExpectedWaitSeconds, 0.0f) * 1e9f);
+	AMD::SampleAsyncTaskWithPriority("FmTaskFuncUpdateSceneStart", AMD::FmTaskFuncUpdateSceneStart, TaskData, 0, 1,
+		AMD::SAMPLE_TASK_PRIORITY_NORMAL, DeadlineNs);
+}
+
+void AFEMFXScene::PostAsyncSceneUpdate(void* TaskData, int32_t TaskBeginIndex, int32_t TaskEndIndex)
+{
+	(void)TaskBeginIndex;
+	(void)TaskEndIndex;
+
+	// Runs on a worker thread
+	AFEMFXScene* Scene = (AFEMFXScene*)TaskData;
+	Scene->AsyncUpdateEndTime = FPlatformTime::Seconds();
+	AMD::SampleTriggerSyncEvent(Scene->AsyncUpdateEvent);
+}
+
+void AFEMFXScene::WaitForAsyncUpdate()
+{
+	if (AsyncUpdateEvent)
+	{
+		AMD::SampleWaitForSyncEvent(AsyncUpdateEvent);
+		AMD::SampleDestroySyncEvent(AsyncUpdateEvent);
+		AsyncUpdateEvent = nullptr;
+	}
+}
+
+static FEMCollision MakeFEMCollision(const AMD::FmTetMesh* TetMesh, uint32 TetId, const float BaryPos[4], const AMD::FmVector3& Normal, UFEMFXMeshComponent* OtherComponent)
+{
+	FEMCollision Collision;
+	Collision.OtherComponent = OtherComponent;
+	Collision.Normal = ConvertFEMFXVectorToUnreal(Normal);
+	Collision.Position = ConvertFEMFXVectorToUnreal(AMD::FmGetInterpolatedPosition(BaryPos, *TetMesh, TetId)) * 100;
+	Collision.TetInfo = CreateTetInfo(TetMesh, TetId);
+	Collision.BarCentricPositions.AddUninitialized(4);
+	Collision.BarCentricPositions[0] = BaryPos[0];
+	Collision.BarCentricPositions[1] = BaryPos[1];
+	Collision.BarCentricPositions[2] = BaryPos[2];
+	Collision.BarCentricPositions[3] = BaryPos[3];
+	return Collision;
+}
+
+void AFEMFXScene::DispatchCollisionEvents()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_CollisionCallback);
+
+    AMD::FmCollisionReport& CollisionReport = FmGetSceneCollisionReportRef(AMDFXSceneBuffer);
+	AMD::uint NumContacts = CollisionReport.numDistanceContacts.val;
+	if (NumContacts == 0)
+	{
+		return;
+	}
+
+	for (auto& Pending : PendingCollisions)
+	{
+		Pending.Value.Reset();
+	}
+	CollidingComponents.Reset();
+
+	// Group contacts by component so each one gets a single batched callback
+	for (AMD::uint i = 0; i < NumContacts; ++i)
+	{
+		const AMD::FmCollisionReportDistanceContact& Contact = CollisionReport.distanceContactBuffer[i];
+
+		AMD::FmTetMesh* tetMeshA = AMD::FmGetTetMesh(*AMDFXSceneBuffer, Contact.objectIdA);
+		AMD::FmTetMesh* tetMeshB = AMD::FmGetTetMesh(*AMDFXSceneBuffer, Contact.objectIdB);
+
+		if (tetMeshA == nullptr || tetMeshB == nullptr)
+			continue;
+
+		UFEMFXMeshComponent** FoundA = ComponentsByBufferId.Find(AMD::FmGetTetMeshBufferId(*tetMeshA));
+		UFEMFXMeshComponent** FoundB = ComponentsByBufferId.Find(AMD::FmGetTetMeshBufferId(*tetMeshB));
+		UFEMFXMeshComponent* compA = FoundA ? *FoundA : nullptr;
+		UFEMFXMeshComponent* compB = FoundB ? *FoundB : nullptr;
+
+		if (compA != nullptr)
+		{
+			TArray<FEMCollision>& Collisions = PendingCollisions.FindOrAdd(compA);
+			if (Collisions.Num() == 0)
 			{
-				colA.OtherComponent = compB;
-				compA->OnHit(colA);
-				compA->CollisionEvent.Broadcast(colA);
+				CollidingComponents.Add(compA);
 			}
-			if (compB != nullptr)
+			Collisions.Add(MakeFEMCollision(tetMeshA, Contact.tetIdA, Contact.posBaryA, Contact.normal, compB));
+		}
+		if (compB != nullptr)
+		{
+			TArray<FEMCollision>& Collisions = PendingCollisions.FindOrAdd(compB);
+			if (Collisions.Num() == 0)
 			{
-				colB.OtherComponent = compA;
-				compB->OnHit(colB);
-				compB->CollisionEvent.Broadcast(colB);
+				CollidingComponents.Add(compB);
 			}
+			Collisions.Add(MakeFEMCollision(tetMeshB, Contact.tetIdB, Contact.posBaryB, Contact.normal, compA));
 		}
 	}
 
-	//timeElapsed -= timestep;
-}
+	// Handlers may free components, so look each one up again rather than iterating the map
+	for (int i = 0; i < CollidingComponents.Num(); ++i)
+	{
+		UFEMFXMeshComponent* Comp = CollidingComponents[i];
+		TArray<FEMCollision>* Collisions = PendingCollisions.Find(Comp);
+
+		if (Collisions == nullptr || !IsValid(Comp))
+			continue;
 
+		// Moved out while handlers run, then handed back so the allocation is reused next frame
+		TArray<FEMCollision> Batch = MoveTemp(*Collisions);
+
+		Comp->OnHits(Batch);
+		Comp->CollisionsEvent.Broadcast(Batch);
+
+		if (Comp->CollisionEvent.IsBound())
+		{
+			for (int j = 0; j < Batch.Num(); ++j)
+			{
+				Comp->CollisionEvent.Broadcast(Batch[j]);
+			}
+		}
+
+		Collisions = PendingCollisions.Find(Comp);
+		if (Collisions != nullptr)
+		{
+			*Collisions = MoveTemp(Batch);
+		}
+	}
+}
 
 AMD::FmScene* AFEMFXScene::GetSceneBuffer()
 {
 	if (!bIsInitialized)
 		Initialize();
 
+	WaitForAsyncUpdate();
+
 	return AMDFXSceneBuffer;
 }
 
 void AFEMFXScene::UpdateRenderingDataFromFracture()
 {
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateRenderingDataFromFracture);
+
 	UWorld* World = GetWorld();
 
 	if (World)
 	{
-		AMD::uint NumTetMeshBuffers = m_ComponentsAllocated.Num();
-
-		for (AMD::uint i = 0; i < NumTetMeshBuffers; i++)
+		ParallelComponents.Reset();
+		for (UFEMFXMeshComponent* Component : m_ComponentsAllocated)
 		{
-			if (i >= (AMD::uint)m_ComponentsAllocated.Num())
+			if (IsValid(Component) && IsValid(Component->FEMMesh) && Component->GetTetMeshBuffer())
 			{
-				continue;
+				ParallelComponents.Add(Component);
 			}
-			if (!m_ComponentsAllocated[i]->IsPendingKill())
-			{
-				if (!IsValid(m_ComponentsAllocated[i]->FEMMesh))
-					continue;
+		}
+
+		// Each component only reads its own tet mesh buffer, events go out afterwards on this thread
+		TArray<UFEMFXMeshComponent*>& Components = ParallelComponents;
+		ParallelFor(Components.Num(), [&Components](int32 Index)
+		{
+			Components[Index]->GatherFractureData();
+		}, Components.Num() < FEMParallelComponentThreshold);
 
-				m_ComponentsAllocated[i]->UpdateRenderingDataFromFracture();
+		// Handlers can free components, so iterate a copy
+		TArray<UFEMFXMeshComponent*> BroadcastComponents = ParallelComponents;
+		for (UFEMFXMeshComponent* Component : BroadcastComponents)
+		{
+			if (IsValid(Component))
+			{
+				Component->BroadcastFractureData();
 			}
 		}
 	}
 }
 
+/** Sum of the positions and velocities of a few vertices spread over the mesh, changes with nearly any motion the bounds miss */
+static FVector SampleTetMeshMotion(const AMD::FmTetMesh& TetMesh)
+{
+	AMD::FmVector3 Sum = AMD::FmInitVector3(0.0f);
+
+	AMD::uint NumVerts = FmGetNumVerts(TetMesh);
+	AMD::uint Stride = FMath::Max<AMD::uint>(NumVerts / FEMMotionSampleVerts, 1);
+	for (AMD::uint VertId = 0; VertId < NumVerts; VertId += Stride)
+	{
+		Sum += FmGetVertPosition(TetMesh, VertId) + FmGetVertVelocity(TetMesh, VertId);
+	}
+
+	return FVector(Sum.x, Sum.y, Sum.z);
+}
+
+void AFEMFXScene::GatherChangedComponents()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_GatherChangedComponents);
+
+	ChangedComponents.Reset();
+
+	AMD::uint NumEnabledTetMeshes = AMD::FmGetNumEnabledTetMeshes(*AMDFXSceneBuffer);
+	for (AMD::uint EnabledIdx = 0; EnabledIdx < NumEnabledTetMeshes; EnabledIdx++)
+	{
+		AMD::uint TetMeshId = AMD::FmGetEnabledTetMeshId(*AMDFXSceneBuffer, EnabledIdx);
+		AMD::FmTetMesh* TetMesh = AMD::FmGetTetMesh(*AMDFXSceneBuffer, TetMeshId);
+		if (!TetMesh)
+			continue;
+
+		// Unchanged bounds alone do not mean a mesh is at rest, it can deform or spin inside the same box. A mesh is skipped
+		// only once its bounds and sampled vertices have repeated for several reads; fracture adds meshes with new ids.
+		FBox Bounds = ConvertFEMFXBoundsToUnreal(AMD::FmGetMinPosition(*TetMesh), AMD::FmGetMaxPosition(*TetMesh));
+		FVector Sample = SampleTetMeshMotion(*TetMesh);
+
+		FFEMTetMeshMotion* Motion = TetMeshMotion.Find(TetMeshId);
+		if (!Motion)
+		{
+			Motion = &TetMeshMotion.Add(TetMeshId);
+		}
+		else if (Motion->Bounds == Bounds && Motion->Sample == Sample)
+		{
+			Motion->StillReads++;
+		}
+		else
+		{
+			Motion->StillReads = 0;
+		}
+
+		Motion->Bounds = Bounds;
+		Motion->Sample = Sample;
+
+		if (Motion->StillReads >= FEMStillReadsBeforeSkip)
+			continue;
+
+		UFEMFXMeshComponent* Component = ComponentsByBufferId.FindRef(AMD::FmGetTetMeshBufferId(*TetMesh));
+		if (Component)
+		{
+			ChangedComponents.Add(Component);
+		}
+	}
+}
+
 void AFEMFXScene::UpdateSimData()
 {
 	UWorld* World = GetWorld();
 
 	if (World)
 	{
-		AMD::uint NumTetMeshBuffers = m_ComponentsAllocated.Num();
+		GatherChangedComponents();
 
-		for (AMD::uint i = 0; i < NumTetMeshBuffers; i++)
+		ParallelComponents.Reset();
+		for (UFEMFXMeshComponent* Component : m_ComponentsAllocated)
 		{
-			if (i >= (AMD::uint)m_ComponentsAllocated.Num())
+			if (IsValid(Component) && ChangedComponents.Contains(Component))
 			{
-				continue;
+				ParallelComponents.Add(Component);
 			}
-			if (!m_ComponentsAllocated[i]->IsPendingKill())
+		}
+
+		{
+			QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_CaptureSimState);
+
+			// Reading back the simulated state only touches each component's own buffers, the render commands are enqueued below
+			TArray<UFEMFXMeshComponent*>& Components = ParallelComponents;
+			ParallelFor(Components.Num(), [&Components](int32 Index)
 			{
+				Components[Index]->CaptureSimState();
+			}, Components.Num() < FEMParallelComponentThreshold);
+		}
 
-				AMD::FmTetMeshBuffer* TetMeshBuffer = m_ComponentsAllocated[i]->GetTetMeshBuffer();// SimResource->TetMeshBuffer;
-				UFEMFXMeshComponent* FEMMeshComponent = m_ComponentsAllocated[i];
+		int32 NumUpdated = ParallelComponents.Num();
+		int32 NumSkipped = 0;
 
-				if (IsValid(FEMMeshComponent))
-				{
-					FEMMeshComponent->UpdateSceneProxy();
+		for (UFEMFXMeshComponent* FEMMeshComponent : m_ComponentsAllocated)
+		{
+			if (!IsValid(FEMMeshComponent))
+			{
+				continue;
+			}
 
-					if (FEMMeshComponent->FractureEnabled)
-					{
-						FEMMeshComponent->UpdateSceneProxyFromFracture();
-					}
-				}
-				
+			if (!ChangedComponents.Contains(FEMMeshComponent))
+			{
+				FEMMeshComponent->MarkSimStateUnchanged();
+				NumSkipped++;
+			}
+
+			if (!bInterpolateRendering)
+			{
+				FEMMeshComponent->UpdateSceneProxyInterpolated(1.0f);
+			}
+
+			if (FEMMeshComponent->FractureEnabled)
+			{
+				FEMMeshComponent->UpdateSceneProxyFromFracture();
 			}
 		}
+
+		SET_DWORD_STAT(STAT_FEM_RenderDataUpdated, NumUpdated);
+		SET_DWORD_STAT(STAT_FEM_RenderDataSkipped, NumSkipped);
 	}
 }
 
@@ -558,3 +1615,156 @@ bool AFEMFXScene::IsConditionChecked(FString name)
 {
     return ConditionCheckedMeshes.Contains(name);
 }
+
+void AFEMFXScene::CaptureStepStartPositions()
+{
+	for (int i = 0; i < m_ComponentsAllocated.Num(); ++i)
+	{
+		UFEMFXMeshComponent* FEMMeshComponent = m_ComponentsAllocated[i];
+
+		if (IsValid(FEMMeshComponent) && !FEMMeshComponent->IsPendingKill())
+		{
+			FEMMeshComponent->CaptureStepStartPositions();
+		}
+	}
+}
+
+void AFEMFXScene::UpdateRenderInterpolation(float Alpha)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FEMScene_UpdateRenderInterpolation);
+
+	Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f);
+
+	for (int i = 0; i < m_ComponentsAllocated.Num(); ++i)
+	{
+		UFEMFXMeshComponent* FEMMeshComponent = m_ComponentsAllocated[i];
+
+		if (IsValid(FEMMeshComponent) && !FEMMeshComponent->IsPendingKill())
+		{
+			FEMMeshComponent->UpdateSceneProxyInterpolated(Alpha);
+		}
+	}
+}
+
+void AFEMFXScene::UpdateBudgetGovernor(float DeltaTime)
+{
+	int maxSteps = FMath::Max(FMath::FloorToInt(MaxSteps), 1);
+
+	if (!bEnableBudgetGovernor)
+	{
+		// Restore authored quality if the governor was switched off while scaled down
+		BudgetMaxSteps = maxSteps;
+		if (AppliedSolveQualityScale < 1.0f)
+		{
+			BudgetSolveQualityScale = 1.0f;
+			ApplySolveQualityScale();
+		}
+		return;
+	}
+
+	// Only frames that ran a step say anything about the cost of a step
+	if (FrameUpdateSeconds > 0.0)
+	{
+		float UpdateMilliseconds = (float)(FrameUpdateSeconds * 1000.0);
+		BudgetUpdateMilliseconds = BudgetUpdateMilliseconds > 0.0f ? FMath::Lerp(BudgetUpdateMilliseconds, UpdateMilliseconds, 0.2f) : UpdateMilliseconds;
+	}
+
+	SET_FLOAT_STAT(STAT_FEMBudget_UpdateMs, BudgetUpdateMilliseconds);
+
+	// Adjust a few times a second so each change has time to show in the smoothed cost
+	BudgetNextAdjustTime -= DeltaTime;
+	if (BudgetNextAdjustTime > 0.0f)
+	{
+		return;
+	}
+	BudgetNextAdjustTime = 0.25f;
+
+	int minSteps = FMath::Clamp(MinStepsFloor, 1, maxSteps);
+	float minScale = FMath::Clamp(MinSolveQualityScale, 0.05f, 1.0f);
+
+	if (BudgetUpdateMilliseconds > BudgetMilliseconds)
+	{
+		// Dropping steps slows the simulation down, so give up solver iterations first
+		if (BudgetSolveQualityScale > minScale)
+		{
+			BudgetSolveQualityScale = FMath::Max(minScale, BudgetSolveQualityScale * 0.8f);
+		}
+		else if (BudgetMaxSteps > minSteps)
+		{
+			BudgetMaxSteps--;
+		}
+	}
+	else if (BudgetUpdateMilliseconds < BudgetMilliseconds * 0.7f)
+	{
+		if (BudgetMaxSteps < maxSteps)
+		{
+			BudgetMaxSteps++;
+		}
+		else if (BudgetSolveQualityScale < 1.0f)
+		{
+			BudgetSolveQualityScale = FMath::Min(1.0f, BudgetSolveQualityScale * 1.1f);
+		}
+	}
+
+	BudgetMaxSteps = FMath::Clamp(BudgetMaxSteps, minSteps, maxSteps);
+	BudgetSolveQualityScale = FMath::Clamp(BudgetSolveQualityScale, minScale, 1.0f);
+
+	if (!FMath::IsNearlyEqual(BudgetSolveQualityScale, AppliedSolveQualityScale))
+	{
+		UE_LOG(FEMLog, Log, TEXT("FEM budget %s: update %.2f ms of %.2f ms, solve quality %.2f, max steps %d"),
+			*GetName(), BudgetUpdateMilliseconds, BudgetMilliseconds, BudgetSolveQualityScale, BudgetMaxSteps);
+
+		ApplySolveQualityScale();
+	}
+
+	SET_FLOAT_STAT(STAT_FEMBudget_SolveQuality, BudgetSolveQualityScale);
+	SET_DWORD_STAT(STAT_FEMBudget_MaxSteps, BudgetMaxSteps);
+}
+
+void AFEMFXScene::ApplySolveQualityScale()
+{
+	if (AMDFXSceneBuffer == nullptr)
+	{
+		return;
+	}
+
+	// Rewriting solver params and tet materials during a step would race with its tasks
+	check(AsyncUpdateEvent == nullptr);
+
+	float Scale = BudgetSolveQualityScale;
+	AMD::uint MinIterations = (AMD::uint)FMath::Max(MinConstraintSolveIterations, 1);
+
+	auto ScaleIterations = [Scale, MinIterations](AMD::uint Authored) -> AMD::uint
+	{
+		AMD::uint Scaled = (AMD::uint)FMath::RoundToInt(Authored * Scale);
+		return FMath::Max(Scaled, FMath::Min(MinIterations, Authored));
+	};
+
+	// Start from the live params so only the iteration counts change
+	AMD::FmSceneControlParams Params = AMD::FmGetSceneControlParams(*AMDFXSceneBuffer);
+
+	AMD::FmConstraintSolverControlParams* SolverParams[2] = { &Params.constraintSolveParams, &Params.constraintStabilizationParams };
+	const AMD::FmConstraintSolverControlParams* AuthoredParams[2] = { &AuthoredControlParams.constraintSolveParams, &AuthoredControlParams.constraintStabilizationParams };
+
+	for (int i = 0; i < 2; i++)
+	{
+		for (int PassIdx = 0; PassIdx < 2; PassIdx++)
+		{
+			SolverParams[i]->passParams[PassIdx].maxOuterIterations = ScaleIterations(AuthoredParams[i]->passParams[PassIdx].maxOuterIterations);
+			SolverParams[i]->passParams[PassIdx].maxInnerIterations = ScaleIterations(AuthoredParams[i]->passParams[PassIdx].maxInnerIterations);
+		}
+		SolverParams[i]->maxCgIterationsCgPass = ScaleIterations(AuthoredParams[i]->maxCgIterationsCgPass);
+	}
+
+	AMD::FmSetSceneControlParams(AMDFXSceneBuffer, Params);
+
+	for (int i = 0; i < m_ComponentsAllocated.Num(); ++i)
+	{
+		if (IsValid(m_ComponentsAllocated[i]))
+		{
+			m_ComponentsAllocated[i]->SetSolveIterationScale(Scale, MinUnconstrainedSolveIterations);
+		}
+	}
+
+	AppliedSolveQualityScale = Scale;
+}
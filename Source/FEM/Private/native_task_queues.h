@@ -0,0 +1,231 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Lock-free task queues of the native task system: a per worker Chase-Lev deque and the bounded injection queue
+// shared by threads outside the pool. Both hold task records by value in fixed arrays.
+// Only depends on the C++ standard library, so the queues can be tested on their own.
+
+#pragma once
+
+#include "sample_task_system.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace AMD
+{
+    static const int64_t kNativeDequeCapacity = 2048;       // Per worker and priority class, power of two
+    static const size_t kNativeInjectionCapacity = 4096;    // Per priority class, shared by threads outside the pool, power of two
+    static const size_t kNativeCacheLineSize = 64;
+
+    struct NativeTask
+    {
+        const char* taskName;
+        FmTaskFuncCallback TaskFunc;
+        void* taskData;
+        int32_t taskBeginIndex;
+        int32_t taskEndIndex;
+        uint64_t deadlineNs;
+        int32_t priority;
+    };
+
+    // A thief may read a slot while the owner is reusing it, so the fields are atomics.
+    // The read is only used if the thief then wins the CAS on top, which means the owner could not have overwritten it.
+    struct NativeTaskSlot
+    {
+        std::atomic<const char*> taskName;
+        std::atomic<FmTaskFuncCallback> TaskFunc;
+        std::atomic<void*> taskData;
+        std::atomic<int32_t> taskBeginIndex;
+        std::atomic<int32_t> taskEndIndex;
+        std::atomic<uint64_t> deadlineNs;
+        std::atomic<int32_t> priority;
+
+        void Store(const NativeTask& task)
+        {
+            taskName.store(task.taskName, std::memory_order_relaxed);
+            TaskFunc.store(task.TaskFunc, std::memory_order_relaxed);
+            taskData.store(task.taskData, std::memory_order_relaxed);
+            taskBeginIndex.store(task.taskBeginIndex, std::memory_order_relaxed);
+            taskEndIndex.store(task.taskEndIndex, std::memory_order_relaxed);
+            deadlineNs.store(task.deadlineNs, std::memory_order_relaxed);
+            priority.store(task.priority, std::memory_order_relaxed);
+        }
+
+        void Load(NativeTask& task) const
+        {
+            task.taskName = taskName.load(std::memory_order_relaxed);
+            task.TaskFunc = TaskFunc.load(std::memory_order_relaxed);
+            task.taskData = taskData.load(std::memory_order_relaxed);
+            task.taskBeginIndex = taskBeginIndex.load(std::memory_order_relaxed);
+            task.taskEndIndex = taskEndIndex.load(std::memory_order_relaxed);
+            task.deadlineNs = deadlineNs.load(std::memory_order_relaxed);
+            task.priority = priority.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Fixed capacity Chase-Lev deque, following the C11 formulation of Le et al. "Correct and Efficient Work-Stealing for Weak Memory Models"
+    class NativeWorkStealingDeque
+    {
+    public:
+        NativeWorkStealingDeque() : top(0), bottom(0) {}
+
+        // Owner only. Returns false when full.
+        bool Push(const NativeTask& task)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            if (b - t >= kNativeDequeCapacity)
+            {
+                return false;
+            }
+
+            slots[b & (kNativeDequeCapacity - 1)].Store(task);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Owner only, takes the most recently pushed task
+        bool Pop(NativeTask& task)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            slots[b & (kNativeDequeCapacity - 1)].Load(task);
+            if (t < b)
+            {
+                return true;
+            }
+
+            // Last task, race thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        // Any thread, takes the oldest task
+        bool Steal(NativeTask& task)
+        {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b)
+            {
+                return false;
+            }
+
+            slots[t & (kNativeDequeCapacity - 1)].Load(task);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+    private:
+        // Padded rather than alignas so the deques can be allocated with plain new before C++17
+        std::atomic<int64_t> top;
+        char topPadding[kNativeCacheLineSize];
+        std::atomic<int64_t> bottom;
+        char bottomPadding[kNativeCacheLineSize];
+        NativeTaskSlot slots[kNativeDequeCapacity];
+    };
+
+    // Bounded multi-producer multi-consumer queue (Vyukov). Each cell's sequence number says whether it is ready to write or read.
+    class NativeInjectionQueue
+    {
+    public:
+        NativeInjectionQueue() : enqueuePos(0), dequeuePos(0)
+        {
+            for (size_t i = 0; i < kNativeInjectionCapacity; i++)
+            {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool Push(const NativeTask& task)
+        {
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;)
+            {
+                cell = &cells[pos & (kNativeInjectionCapacity - 1)];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->task = task;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(NativeTask& task)
+        {
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;)
+            {
+                cell = &cells[pos & (kNativeInjectionCapacity - 1)];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0)
+                {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            task = cell->task;
+            cell->sequence.store(pos + kNativeInjectionCapacity, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            NativeTask task;
+        };
+
+        Cell cells[kNativeInjectionCapacity];
+        std::atomic<size_t> enqueuePos;
+        char enqueuePadding[kNativeCacheLineSize];
+        std::atomic<size_t> dequeuePos;
+        char dequeuePadding[kNativeCacheLineSize];
+    };
+}
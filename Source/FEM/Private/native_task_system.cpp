@@ -0,0 +1,513 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+#include "native_task_system.h"
+#include "native_task_queues.h"
+#include "sample_object_pool.h"
+#include "sample_task_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NATIVE_CPU_PAUSE() _mm_pause()
+#else
+#define NATIVE_CPU_PAUSE() std::this_thread::yield()
+#endif
+
+namespace AMD
+{
+    static const uint64_t kNativeDeadlineUrgentNs = 2000000; // Tasks submitted or taken closer than this to their deadline are promoted to critical
+    static const int kNativeMaxWorkers = 63;
+    static const int kNativeIdleSpins = 64;                 // Failed searches before a worker sleeps
+    static const uint32_t kNativeSyncEventsPerThread = 8;
+    static const uint32_t kNativeMinSyncEvents = 64;
+    static const int kNativeWaitSpins = 512;                // Checks of a sync event before the waiter starts running tasks
+    static const int kNativeHelpAttempts = 32;              // Failed searches for work before the waiter sleeps
+    static const int kNativeHelpSleepMicroseconds = 200;    // Sleeping waiters wake this often to look for work again
+
+    struct NativeWorker
+    {
+        NativeWorkStealingDeque deques[SAMPLE_TASK_PRIORITY_COUNT];
+        std::thread thread;
+    };
+
+    struct NativeTaskSystem
+    {
+        int numWorkers;
+        NativeWorker* workers;
+        NativeInjectionQueue injectionQueues[SAMPLE_TASK_PRIORITY_COUNT];
+
+        std::atomic<bool> quit;
+        std::atomic<int> numStarted;
+
+        // Worker indices at or above this are parked: they finish what is in their own deque, then sleep on
+        // parkCondition without taking new work. Every thread is started up front, so resizing never creates one.
+        std::atomic<int> numActiveThreads;
+
+        // Queued tasks not yet taken, checked by workers before they sleep
+        std::atomic<int64_t> numQueued;
+        std::atomic<int> numSleeping;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        std::condition_variable parkCondition;
+    };
+
+    struct NativeSyncEvent
+    {
+        std::atomic<bool> triggered;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    static NativeTaskSystem* gNativeTaskSystem = nullptr;
+    static int gNativeTaskSystemNumThreads = 1;
+    static SampleWorkerStartCallback gNativeWorkerStartCallback = nullptr;
+
+    // Outlives the task system so events created before a restart can still be returned to it
+    static SampleObjectPool<NativeSyncEvent> gNativeSyncEventPool;
+
+    // 0 outside the pool
+    static thread_local int tNativeWorkerIndex = 0;
+    static thread_local uint32_t tNativeRandomState = 0x9E3779B9u;
+
+    // Given to tasks submitted through NativeSubmitAsyncTask(). Set to the running task's while it runs, so its children inherit them.
+    static thread_local SampleTaskPriority tNativeThreadPriority = SAMPLE_TASK_PRIORITY_NORMAL;
+    static thread_local uint64_t tNativeThreadDeadlineNs = 0;
+
+    // Set on the thread that started the task system. It owns worker index 0, so it is the only thread outside the pool that may run tasks.
+    static thread_local bool tNativeIsOwnerThread = false;
+
+    static uint32_t NativeNextRandom(uint32_t& state)
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Checked when a task is submitted and again when a worker takes it. A promoted task keeps its place in the queue it
+    // is already in, but it runs as critical, so everything it submits jumps ahead of other work.
+    static void NativePromoteUrgentTask(NativeTask& task)
+    {
+        if (task.deadlineNs != 0 && task.priority != SAMPLE_TASK_PRIORITY_CRITICAL && SampleGetTaskSystemTimeNs() + kNativeDeadlineUrgentNs >= task.deadlineNs)
+        {
+            task.priority = SAMPLE_TASK_PRIORITY_CRITICAL;
+        }
+    }
+
+    // workerIdx is -1 for the owner thread, which has no deques of its own
+    static bool NativeFindTask(NativeTaskSystem& taskSystem, int workerIdx, NativeTask& task)
+    {
+        int numWorkers = taskSystem.numWorkers;
+
+        for (int priority = 0; priority < SAMPLE_TASK_PRIORITY_COUNT; priority++)
+        {
+            if ((workerIdx >= 0 && taskSystem.workers[workerIdx].deques[priority].Pop(task)) || taskSystem.injectionQueues[priority].Pop(task))
+            {
+                NativePromoteUrgentTask(task);
+                return true;
+            }
+
+            // Start at a random victim so idle workers don't all hammer the same deque
+            int start = (int)(NativeNextRandom(tNativeRandomState) % (uint32_t)numWorkers);
+            for (int i = 0; i < numWorkers; i++)
+            {
+                int victimIdx = (start + i) % numWorkers;
+                if (victimIdx != workerIdx && taskSystem.workers[victimIdx].deques[priority].Steal(task))
+                {
+                    NativePromoteUrgentTask(task);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // A parked worker only drains its own deques
+    static bool NativePopOwnTask(NativeWorker& worker, NativeTask& task)
+    {
+        for (int priority = 0; priority < SAMPLE_TASK_PRIORITY_COUNT; priority++)
+        {
+            if (worker.deques[priority].Pop(task))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static void NativeRunTask(int workerIndex, const NativeTask& task)
+    {
+        SampleTaskPriority parentPriority = tNativeThreadPriority;
+        uint64_t parentDeadlineNs = tNativeThreadDeadlineNs;
+        tNativeThreadPriority = (SampleTaskPriority)task.priority;
+        tNativeThreadDeadlineNs = task.deadlineNs;
+
+        SampleRunTask(workerIndex, task.taskName, task.TaskFunc, task.taskData, task.taskBeginIndex, task.taskEndIndex);
+
+        tNativeThreadPriority = parentPriority;
+        tNativeThreadDeadlineNs = parentDeadlineNs;
+    }
+
+    static void NativeWorkerMain(NativeTaskSystem* taskSystem, int workerIdx)
+    {
+        tNativeWorkerIndex = workerIdx + 1;
+        tNativeRandomState = 0x9E3779B9u * (uint32_t)(workerIdx + 2);
+
+        if (gNativeWorkerStartCallback)
+        {
+            gNativeWorkerStartCallback(tNativeWorkerIndex);
+        }
+        taskSystem->numStarted.fetch_add(1, std::memory_order_release);
+
+        int idleSpins = 0;
+        while (!taskSystem->quit.load(std::memory_order_acquire))
+        {
+            bool isActive = tNativeWorkerIndex < taskSystem->numActiveThreads.load(std::memory_order_relaxed);
+
+            NativeTask task;
+            if (isActive ? NativeFindTask(*taskSystem, workerIdx, task) : NativePopOwnTask(taskSystem->workers[workerIdx], task))
+            {
+                taskSystem->numQueued.fetch_sub(1, std::memory_order_relaxed);
+                NativeRunTask(tNativeWorkerIndex, task);
+                idleSpins = 0;
+                continue;
+            }
+
+            if (!isActive)
+            {
+                std::unique_lock<std::mutex> lock(taskSystem->sleepMutex);
+                while (tNativeWorkerIndex >= taskSystem->numActiveThreads.load(std::memory_order_relaxed) && !taskSystem->quit.load(std::memory_order_acquire))
+                {
+                    taskSystem->parkCondition.wait(lock);
+                }
+                idleSpins = 0;
+                continue;
+            }
+
+            if (++idleSpins < kNativeIdleSpins)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Submitters bump numQueued before reading numSleeping, and we bump numSleeping before reading numQueued,
+            // so at least one side sees the other and a wakeup can't be lost.
+            // Also leaves when parked, to go around the loop and wait on parkCondition instead.
+            std::unique_lock<std::mutex> lock(taskSystem->sleepMutex);
+            taskSystem->numSleeping.fetch_add(1, std::memory_order_seq_cst);
+            while (taskSystem->numQueued.load(std::memory_order_seq_cst) <= 0 && !taskSystem->quit.load(std::memory_order_acquire) &&
+                tNativeWorkerIndex < taskSystem->numActiveThreads.load(std::memory_order_relaxed))
+            {
+                taskSystem->sleepCondition.wait(lock);
+            }
+            taskSystem->numSleeping.fetch_sub(1, std::memory_order_relaxed);
+
+            // Parked while asleep, so the wakeup was meant for an active worker
+            if (tNativeWorkerIndex >= taskSystem->numActiveThreads.load(std::memory_order_relaxed) && taskSystem->numQueued.load(std::memory_order_relaxed) > 0)
+            {
+                taskSystem->sleepCondition.notify_one();
+            }
+            idleSpins = 0;
+        }
+    }
+
+    void NativeInitTaskSystem(int numThreads)
+    {
+        if (gNativeTaskSystem)
+        {
+            NativeDestroyTaskSystem();
+        }
+
+        if (numThreads <= 0)
+        {
+            numThreads = NativeGetTaskSystemDefaultNumThreads();
+        }
+
+        int numWorkers = numThreads - 1;
+        numWorkers = numWorkers < 1 ? 1 : (numWorkers > kNativeMaxWorkers ? kNativeMaxWorkers : numWorkers);
+
+        NativeTaskSystem* taskSystem = new NativeTaskSystem();
+        taskSystem->numWorkers = numWorkers;
+        taskSystem->workers = new NativeWorker[numWorkers];
+        taskSystem->quit.store(false);
+        taskSystem->numStarted.store(0);
+        taskSystem->numQueued.store(0);
+        taskSystem->numSleeping.store(0);
+        taskSystem->numActiveThreads.store(numWorkers + 1);
+
+        gNativeTaskSystem = taskSystem;
+        gNativeTaskSystemNumThreads = numWorkers + 1;
+        tNativeIsOwnerThread = true;
+
+        SampleTaskTraceStartup(gNativeTaskSystemNumThreads);
+
+        // Only resized while no events are out, otherwise the current pool is kept
+        uint32_t numSyncEvents = (uint32_t)gNativeTaskSystemNumThreads * kNativeSyncEventsPerThread;
+        numSyncEvents = numSyncEvents < kNativeMinSyncEvents ? kNativeMinSyncEvents : numSyncEvents;
+        int32_t numEventsInUse, peakEventsInUse, eventCapacity, numEventOverflows;
+        gNativeSyncEventPool.GetStats(numEventsInUse, peakEventsInUse, eventCapacity, numEventOverflows);
+        if (numEventsInUse == 0 && (uint32_t)eventCapacity != numSyncEvents)
+        {
+            gNativeSyncEventPool.Init(numSyncEvents);
+        }
+
+        for (int workerIdx = 0; workerIdx < numWorkers; workerIdx++)
+        {
+            taskSystem->workers[workerIdx].thread = std::thread(NativeWorkerMain, taskSystem, workerIdx);
+        }
+    }
+
+    void NativeDestroyTaskSystem()
+    {
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        if (!taskSystem)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(taskSystem->sleepMutex);
+            taskSystem->quit.store(true, std::memory_order_release);
+        }
+        taskSystem->sleepCondition.notify_all();
+        taskSystem->parkCondition.notify_all();
+
+        for (int workerIdx = 0; workerIdx < taskSystem->numWorkers; workerIdx++)
+        {
+            taskSystem->workers[workerIdx].thread.join();
+        }
+
+        gNativeTaskSystem = nullptr;
+        gNativeTaskSystemNumThreads = 1;
+        tNativeIsOwnerThread = false;
+
+        SampleTaskTraceShutdown();
+
+        delete[] taskSystem->workers;
+        delete taskSystem;
+    }
+
+    int NativeGetTaskSystemNumThreads()
+    {
+        return gNativeTaskSystemNumThreads;
+    }
+
+    void NativeSetTaskSystemNumActiveThreads(int numThreads)
+    {
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        if (!taskSystem)
+        {
+            return;
+        }
+
+        // At least one worker besides index 0 stays active, since threads outside the pool only run tasks while waiting
+        numThreads = numThreads < 2 ? 2 : (numThreads > gNativeTaskSystemNumThreads ? gNativeTaskSystemNumThreads : numThreads);
+
+        {
+            std::lock_guard<std::mutex> lock(taskSystem->sleepMutex);
+            taskSystem->numActiveThreads.store(numThreads, std::memory_order_relaxed);
+        }
+
+        // Woken workers re-check whether they are active, newly parked ones leave the sleep condition for the park condition
+        taskSystem->parkCondition.notify_all();
+        taskSystem->sleepCondition.notify_all();
+    }
+
+    int NativeGetTaskSystemNumActiveThreads()
+    {
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        return taskSystem ? taskSystem->numActiveThreads.load(std::memory_order_relaxed) : gNativeTaskSystemNumThreads;
+    }
+
+    int NativeGetTaskSystemDefaultNumThreads()
+    {
+        // One thread per hardware thread: index 0 is the game thread, so NativeInitTaskSystem() starts one worker fewer
+        int numHardwareThreads = (int)std::thread::hardware_concurrency();
+        return numHardwareThreads > 2 ? numHardwareThreads : 2;
+    }
+
+    void NativeWaitForAllThreadsToStart()
+    {
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        while (taskSystem && taskSystem->numStarted.load(std::memory_order_acquire) < taskSystem->numWorkers)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    int NativeGetTaskSystemWorkerIndex()
+    {
+        return tNativeWorkerIndex;
+    }
+
+    void NativeSetThreadTaskPriority(SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        tNativeThreadPriority = priority;
+        tNativeThreadDeadlineNs = deadlineNs;
+    }
+
+    void NativeGetThreadTaskPriority(SampleTaskPriority& outPriority, uint64_t& outDeadlineNs)
+    {
+        outPriority = tNativeThreadPriority;
+        outDeadlineNs = tNativeThreadDeadlineNs;
+    }
+
+    void NativeSubmitAsyncTask(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex)
+    {
+        NativeSubmitAsyncTaskWithPriority(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex, tNativeThreadPriority, tNativeThreadDeadlineNs);
+    }
+
+    void NativeSubmitAsyncTaskWithPriority(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex,
+        SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        if (!taskSystem)
+        {
+            TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+            return;
+        }
+
+        NativeTask task;
+        task.taskName = taskName;
+        task.TaskFunc = TaskFunc;
+        task.taskData = taskData;
+        task.taskBeginIndex = taskBeginIndex;
+        task.taskEndIndex = taskEndIndex;
+        task.deadlineNs = deadlineNs;
+        task.priority = priority < SAMPLE_TASK_PRIORITY_COUNT ? priority : SAMPLE_TASK_PRIORITY_BACKGROUND;
+        NativePromoteUrgentTask(task);
+
+        int workerIndex = tNativeWorkerIndex;
+        bool queued = workerIndex > 0 && taskSystem->workers[workerIndex - 1].deques[task.priority].Push(task);
+        if (!queued)
+        {
+            queued = taskSystem->injectionQueues[task.priority].Push(task);
+        }
+
+        if (!queued)
+        {
+            // Every queue is full, running it here is cheaper than growing them.
+            // Only traced on threads that own their index, others outside the pool would share index 0.
+            if (workerIndex > 0 || tNativeIsOwnerThread)
+            {
+                NativeRunTask(workerIndex, task);
+            }
+            else
+            {
+                TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+            }
+            return;
+        }
+
+        taskSystem->numQueued.fetch_add(1, std::memory_order_seq_cst);
+        if (taskSystem->numSleeping.load(std::memory_order_seq_cst) > 0)
+        {
+            // Taking the lock makes sure a worker that saw no work has reached wait() before being notified
+            {
+                std::lock_guard<std::mutex> lock(taskSystem->sleepMutex);
+            }
+            taskSystem->sleepCondition.notify_one();
+        }
+    }
+
+    void* NativeCreateSyncEvent()
+    {
+        NativeSyncEvent* syncEvent = gNativeSyncEventPool.New();
+        syncEvent->triggered.store(false, std::memory_order_relaxed);
+        return syncEvent;
+    }
+
+    void NativeDestroySyncEvent(void* taskEvent)
+    {
+        gNativeSyncEventPool.Delete((NativeSyncEvent*)taskEvent);
+    }
+
+    void NativeSetTaskSystemWorkerStartCallback(SampleWorkerStartCallback callback)
+    {
+        gNativeWorkerStartCallback = callback;
+    }
+
+    void NativeGetTaskSystemPoolStats(SampleTaskSystemPoolStats& outStats)
+    {
+        // Tasks are stored by value in the worker deques and injection queue, so there is no task record pool
+        outStats.numTasksInUse = 0;
+        outStats.peakTasksInUse = 0;
+        outStats.taskCapacity = 0;
+        outStats.numTaskOverflows = 0;
+
+        gNativeSyncEventPool.GetStats(outStats.numEventsInUse, outStats.peakEventsInUse, outStats.eventCapacity, outStats.numEventOverflows);
+    }
+
+    void NativeWaitForSyncEvent(void* taskEvent)
+    {
+        NativeSyncEvent* syncEvent = (NativeSyncEvent*)taskEvent;
+
+        // Short waits are common, so spin first
+        for (int spin = 0; spin < kNativeWaitSpins && !syncEvent->triggered.load(std::memory_order_acquire); spin++)
+        {
+            NATIVE_CPU_PAUSE();
+        }
+
+        // Then run queued tasks here rather than idling, which with few workers is close to an extra worker.
+        // Threads outside the pool would share index 0 with the owner thread, so they only block.
+        NativeTaskSystem* taskSystem = gNativeTaskSystem;
+        int workerIndex = tNativeWorkerIndex;
+        if (taskSystem && (workerIndex > 0 || tNativeIsOwnerThread))
+        {
+            int failedAttempts = 0;
+            while (!syncEvent->triggered.load(std::memory_order_acquire))
+            {
+                NativeTask task;
+                if (NativeFindTask(*taskSystem, workerIndex - 1, task))
+                {
+                    taskSystem->numQueued.fetch_sub(1, std::memory_order_relaxed);
+                    NativeRunTask(workerIndex, task);
+                    failedAttempts = 0;
+                }
+                else if (++failedAttempts < kNativeHelpAttempts)
+                {
+                    NATIVE_CPU_PAUSE();
+                }
+                else
+                {
+                    // Last resort, sleep until triggered but wake now and then in case more work was queued
+                    std::unique_lock<std::mutex> lock(syncEvent->mutex);
+                    if (!syncEvent->triggered.load(std::memory_order_acquire))
+                    {
+                        syncEvent->condition.wait_for(lock, std::chrono::microseconds(kNativeHelpSleepMicroseconds));
+                    }
+                    failedAttempts = 0;
+                }
+            }
+        }
+
+        // The trigger holds the mutex while notifying, so take it even when the flag is already set.
+        // Otherwise the caller could destroy the event while the triggering thread is still using it.
+        std::unique_lock<std::mutex> lock(syncEvent->mutex);
+        while (!syncEvent->triggered.load(std::memory_order_acquire))
+        {
+            syncEvent->condition.wait(lock);
+        }
+    }
+
+    void NativeTriggerSyncEvent(void* taskEvent)
+    {
+        NativeSyncEvent* syncEvent = (NativeSyncEvent*)taskEvent;
+
+        std::lock_guard<std::mutex> lock(syncEvent->mutex);
+        syncEvent->triggered.store(true, std::memory_order_release);
+        syncEvent->condition.notify_all();
+    }
+}
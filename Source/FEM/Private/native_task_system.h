@@ -0,0 +1,56 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Work-stealing task scheduler behind the USE_NATIVE backend of sample_task_system.cpp.
+// Only depends on the C++ standard library, so it builds and runs outside the engine.
+//
+// Each worker owns a fixed-size Chase-Lev deque per priority class: it pushes and pops its own tasks at the bottom while
+// idle workers steal from the top. Tasks submitted from threads outside the pool go to bounded lock-free injection queues.
+// Workers search every queue of a class before moving to the next one down.
+// Task records are stored by value in these fixed arrays, so submitting a task never allocates.
+// Sync events come from a fixed pool sized from the thread count. Waiting on one spins briefly, then runs queued
+// tasks on the waiting thread, and only sleeps when there is nothing left to run.
+
+#pragma once
+
+#include "sample_task_system.h"
+
+namespace AMD
+{
+    // Starts numThreads - 1 worker threads (at least one). Worker indices are 1..numThreads-1,
+    // index 0 belongs to threads outside the pool such as the game thread. 0 uses the default count.
+    void NativeInitTaskSystem(int numThreads);
+    void NativeDestroyTaskSystem();
+
+    // Number of worker indices, including index 0 for threads outside the pool
+    int NativeGetTaskSystemNumThreads();
+    int NativeGetTaskSystemDefaultNumThreads();
+
+    // Number of threads taking work, between 2 and NativeGetTaskSystemNumThreads(). Workers above it are parked, not destroyed.
+    void NativeSetTaskSystemNumActiveThreads(int numThreads);
+    int NativeGetTaskSystemNumActiveThreads();
+
+    void NativeWaitForAllThreadsToStart();
+
+    int NativeGetTaskSystemWorkerIndex();
+
+    // Queue a task, falling back to running it inline if every queue is full. Runs inline if the task system isn't started.
+    void NativeSubmitAsyncTask(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex);
+    void NativeSubmitAsyncTaskWithPriority(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex,
+        SampleTaskPriority priority, uint64_t deadlineNs);
+
+    void NativeSetThreadTaskPriority(SampleTaskPriority priority, uint64_t deadlineNs);
+    void NativeGetThreadTaskPriority(SampleTaskPriority& outPriority, uint64_t& outDeadlineNs);
+
+    void* NativeCreateSyncEvent();
+    void NativeDestroySyncEvent(void* taskEvent);
+    void NativeWaitForSyncEvent(void* taskEvent);
+    void NativeTriggerSyncEvent(void* taskEvent);
+
+    void NativeGetTaskSystemPoolStats(SampleTaskSystemPoolStats& outStats);
+
+    void NativeSetTaskSystemWorkerStartCallback(SampleWorkerStartCallback callback);
+}
@@ -0,0 +1,159 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Fixed capacity, thread-safe pool of storage for task system objects.
+// Free slots form a lock-free stack of indices; the head carries a tag that changes on every pop so a slot
+// freed and reallocated between another thread's read and its CAS can't corrupt the list (ABA).
+// Only depends on the C++ standard library.
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+
+namespace AMD
+{
+    template<class T>
+    class SampleObjectPool
+    {
+    public:
+        SampleObjectPool() : slots(nullptr), nextFree(nullptr), capacity(0), head(EmptyHead), numInUse(0), peakInUse(0), numOverflows(0) {}
+        ~SampleObjectPool() { Shutdown(); }
+
+        // Not thread-safe, no objects may be in use
+        void Init(uint32_t inCapacity)
+        {
+            Shutdown();
+
+            capacity = inCapacity;
+            slots = new Slot[capacity];
+            nextFree = new std::atomic<uint32_t>[capacity];
+            for (uint32_t i = 0; i < capacity; i++)
+            {
+                nextFree[i].store(i + 1 < capacity ? i + 1 : EmptyIndex, std::memory_order_relaxed);
+            }
+
+            head.store(capacity > 0 ? 0 : EmptyHead, std::memory_order_relaxed);
+            numInUse.store(0, std::memory_order_relaxed);
+            peakInUse.store(0, std::memory_order_relaxed);
+            numOverflows.store(0, std::memory_order_relaxed);
+        }
+
+        void Shutdown()
+        {
+            delete[] slots;
+            delete[] nextFree;
+            slots = nullptr;
+            nextFree = nullptr;
+            capacity = 0;
+            head.store(EmptyHead, std::memory_order_relaxed);
+        }
+
+        // Uninitialized storage for a T, or nullptr when the pool is exhausted, in which case the caller falls back to the heap
+        void* Allocate()
+        {
+            uint64_t oldHead = head.load(std::memory_order_acquire);
+            for (;;)
+            {
+                uint32_t index = (uint32_t)oldHead;
+                if (index == EmptyIndex)
+                {
+                    numOverflows.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+
+                uint64_t newHead = ((oldHead >> 32) + 1) << 32 | nextFree[index].load(std::memory_order_relaxed);
+                if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    int32_t inUse = numInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+                    int32_t peak = peakInUse.load(std::memory_order_relaxed);
+                    while (inUse > peak && !peakInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+                    {
+                    }
+
+                    return &slots[index];
+                }
+            }
+        }
+
+        // ptr must have come from Allocate() and its object already been destroyed
+        void Free(void* ptr)
+        {
+            uint32_t index = (uint32_t)((Slot*)ptr - slots);
+
+            uint64_t oldHead = head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                nextFree[index].store((uint32_t)oldHead, std::memory_order_relaxed);
+                uint64_t newHead = (oldHead & ~(uint64_t)EmptyIndex) | index;
+                if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_release, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            numInUse.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        int32_t GetNumInUse() const
+        {
+            return numInUse.load(std::memory_order_relaxed);
+        }
+
+        bool Owns(const void* ptr) const
+        {
+            return ptr >= (const void*)slots && ptr < (const void*)(slots + capacity);
+        }
+
+        template<class... ArgTypes>
+        T* New(ArgTypes&&... args)
+        {
+            void* mem = Allocate();
+            return mem ? new (mem) T(static_cast<ArgTypes&&>(args)...) : new T(static_cast<ArgTypes&&>(args)...);
+        }
+
+        void Delete(T* object)
+        {
+            if (Owns(object))
+            {
+                object->~T();
+                Free(object);
+            }
+            else
+            {
+                delete object;
+            }
+        }
+
+        void GetStats(int32_t& outInUse, int32_t& outPeakInUse, int32_t& outCapacity, int32_t& outOverflows) const
+        {
+            outInUse = numInUse.load(std::memory_order_relaxed);
+            outPeakInUse = peakInUse.load(std::memory_order_relaxed);
+            outCapacity = (int32_t)capacity;
+            outOverflows = numOverflows.load(std::memory_order_relaxed);
+        }
+
+    private:
+        friend struct SampleObjectPoolTestAccess;
+
+        static const uint32_t EmptyIndex = 0xFFFFFFFFu;
+        static const uint64_t EmptyHead = 0xFFFFFFFFu;
+
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+        Slot* slots;
+        std::atomic<uint32_t>* nextFree;
+        uint32_t capacity;
+
+        std::atomic<uint64_t> head;     // Tag in the high 32 bits, index of the first free slot in the low 32 bits
+
+        std::atomic<int32_t> numInUse;
+        std::atomic<int32_t> peakInUse;
+        std::atomic<int32_t> numOverflows;
+    };
+}
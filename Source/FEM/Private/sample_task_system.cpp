@@ -9,12 +9,125 @@
 #define USE_MULTITHREADING 1
 
 #ifndef SAMPLE_TASK_SYS_ENV_SET
-#define USE_TBB 0
-#define USE_UE4 0
-#define USE_TL  1
+#define USE_TBB    0
+#define USE_UE4    0
+#define USE_TL     0
+#define USE_NATIVE 1
 #endif
 
-#if USE_UE4
+#ifndef USE_NATIVE
+#define USE_NATIVE 0
+#endif
+
+#if USE_NATIVE
+
+// Self-contained work-stealing scheduler, see native_task_system.h
+#include "native_task_system.h"
+
+namespace AMD
+{
+    void SampleInitTaskSystem(int numThreads)
+    {
+#if USE_MULTITHREADING
+        NativeInitTaskSystem(numThreads);
+#else
+        (void)numThreads;
+#endif
+    }
+
+    void SampleDestroyTaskSystem()
+    {
+        NativeDestroyTaskSystem();
+    }
+
+    void SampleWaitForAllThreadsToStart()
+    {
+        NativeWaitForAllThreadsToStart();
+    }
+
+    int SampleGetTaskSystemNumThreads()
+    {
+        return NativeGetTaskSystemNumThreads();
+    }
+
+    void SampleSetTaskSystemNumActiveThreads(int numThreads)
+    {
+        NativeSetTaskSystemNumActiveThreads(numThreads);
+    }
+
+    int SampleGetTaskSystemNumActiveThreads()
+    {
+        return NativeGetTaskSystemNumActiveThreads();
+    }
+
+    int SampleGetTaskSystemDefaultNumThreads()
+    {
+#if USE_MULTITHREADING
+        return NativeGetTaskSystemDefaultNumThreads();
+#else
+        return 1;
+#endif
+    }
+
+    int SampleGetTaskSystemWorkerIndex()
+    {
+        return NativeGetTaskSystemWorkerIndex();
+    }
+
+    // Without a started task system tasks run inline on the submitting thread
+    void SampleAsyncTask(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex)
+    {
+        NativeSubmitAsyncTask(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
+    }
+
+    void SampleAsyncTaskWithPriority(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex,
+        SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        NativeSubmitAsyncTaskWithPriority(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex, priority, deadlineNs);
+    }
+
+    void SampleSetThreadTaskPriority(SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        NativeSetThreadTaskPriority(priority, deadlineNs);
+    }
+
+    void SampleGetThreadTaskPriority(SampleTaskPriority& outPriority, uint64_t& outDeadlineNs)
+    {
+        NativeGetThreadTaskPriority(outPriority, outDeadlineNs);
+    }
+
+    FmSyncEvent* SampleCreateSyncEvent()
+    {
+        return NativeCreateSyncEvent();
+    }
+
+    void SampleDestroySyncEvent(FmSyncEvent* taskEvent)
+    {
+        NativeDestroySyncEvent(taskEvent);
+    }
+
+    void SampleWaitForSyncEvent(FmSyncEvent* taskEvent)
+    {
+        NativeWaitForSyncEvent(taskEvent);
+    }
+
+    void SampleTriggerSyncEvent(FmSyncEvent* taskEvent)
+    {
+        NativeTriggerSyncEvent(taskEvent);
+    }
+
+    void SampleGetTaskSystemPoolStats(SampleTaskSystemPoolStats& outStats)
+    {
+        NativeGetTaskSystemPoolStats(outStats);
+    }
+
+    void SampleSetTaskSystemWorkerStartCallback(SampleWorkerStartCallback callback)
+    {
+        NativeSetTaskSystemWorkerStartCallback(callback);
+    }
+}
+
+#elif USE_UE4
 
 #if USE_MULTITHREADING
 #if USE_TBB
@@ -29,6 +142,8 @@ using namespace tbb;
 #define UE4_QUEUED_WORK 1
 #include "AsyncWork.h"
 #include "TaskGraphInterfaces.h"
+#include "sample_object_pool.h"
+#include "sample_task_trace.h"
 #elif USE_TL
 #include "TLJobSystem.h"
 using namespace TL;
@@ -47,6 +162,65 @@ namespace AMD
 
 #if USE_UE4
     FQueuedThreadPool* gSampleTaskSystemQueuedThreadPool;
+
+    // The game thread is worker 0 and pool threads take 1..numThreads-1. Task graph and GThreadPool threads outlive
+    // our pool, so indices are tagged with the pool generation and claimed afresh after the task system is recreated.
+    FThreadSafeCounter gSampleTaskSystemGeneration;
+    FThreadSafeCounter gSampleTaskSystemLastWorkerIndex;
+    FThreadSafeCounter gSampleTaskSystemNumRegisteredWorkers;
+    SampleWorkerStartCallback gSampleTaskSystemWorkerStartCallback = nullptr;
+    static thread_local int32 tSampleTaskSystemWorkerIndex = -1;
+    static thread_local int32 tSampleTaskSystemWorkerGeneration = -1;
+
+    static int SampleClaimWorkerIndex()
+    {
+        int32 generation = gSampleTaskSystemGeneration.GetValue();
+        if (tSampleTaskSystemWorkerGeneration != generation)
+        {
+            tSampleTaskSystemWorkerGeneration = generation;
+            tSampleTaskSystemWorkerIndex = IsInGameThread() ? 0 : gSampleTaskSystemLastWorkerIndex.Increment();
+        }
+
+        return tSampleTaskSystemWorkerIndex < gSampleTaskSystemNumThreads ? tSampleTaskSystemWorkerIndex : -1;
+    }
+
+#if UE4_QUEUED_WORK
+    class UE4Task;
+
+    // Task records live in a fixed pool sized from the thread count. It outlives the thread pool so tasks
+    // abandoned by a shutdown can still be returned, and is only resized while no records are out.
+    static const uint32_t kSampleTaskRecordsPerThread = 512;
+    extern SampleObjectPool<UE4Task> gSampleTaskPool;
+
+    // Queued once per pool thread when the pool is created. Each blocks until all have run, so every pool thread
+    // claims exactly one index up front instead of racing for them during the first step.
+    class UE4RegisterWorkerTask : public IQueuedWork
+    {
+    public:
+        void Abandon()
+        {
+            delete this;
+        }
+
+        void DoThreadedWork()
+        {
+            int workerIndex = SampleClaimWorkerIndex();
+            if (gSampleTaskSystemWorkerStartCallback)
+            {
+                gSampleTaskSystemWorkerStartCallback(workerIndex);
+            }
+
+            int32 numPoolThreads = gSampleTaskSystemNumThreads - 1;
+            gSampleTaskSystemNumRegisteredWorkers.Increment();
+            while (gSampleTaskSystemNumRegisteredWorkers.GetValue() < numPoolThreads)
+            {
+                FPlatformProcess::YieldThread();
+            }
+
+            delete this;
+        }
+    };
+#endif
 #endif
 
     // Task definition
@@ -78,13 +252,15 @@ namespace AMD
     {
 #endif
     public:
+        const char* taskName;
         FmTaskFuncCallback TaskFunc;
         void* taskData;
         int32_t taskBeginIndex;
         int32_t taskEndIndex;
 
-        UE4Task(FmTaskFuncCallback InTaskFunc, void* inTaskData, int32_t inTaskBeginIndex, int32_t inTaskEndIndex)
+        UE4Task(const char* inTaskName, FmTaskFuncCallback InTaskFunc, void* inTaskData, int32_t inTaskBeginIndex, int32_t inTaskEndIndex)
         {
+            taskName = inTaskName;
             TaskFunc = InTaskFunc;
             taskData = inTaskData;
             taskBeginIndex = inTaskBeginIndex;
@@ -104,7 +280,7 @@ namespace AMD
 
         void DoWork()
         {
-            TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+            SampleRunTask(SampleClaimWorkerIndex(), taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
         }
 #elif UE4_TASK_GRAPH
         FORCEINLINE static TStatId GetStatId()
@@ -124,7 +300,7 @@ namespace AMD
 
         void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
         {
-            TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+            SampleRunTask(SampleClaimWorkerIndex(), taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
         }
 #elif UE4_QUEUED_WORK
         void Abandon()
@@ -133,13 +309,16 @@ namespace AMD
 
         void DoThreadedWork()
         {
-            TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+            SampleRunTask(SampleClaimWorkerIndex(), taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
 
-            FMemory::Free(this);
-            //delete this;
+            gSampleTaskPool.Delete(this);
         }
 #endif
     };
+
+#if UE4_QUEUED_WORK
+    SampleObjectPool<UE4Task> gSampleTaskPool;
+#endif
 #endif
 #endif
 
@@ -162,12 +341,33 @@ namespace AMD
         gSampleTaskSystemQueuedThreadPool = FQueuedThreadPool::Allocate();
         gSampleTaskSystemQueuedThreadPool->Create(gSampleTaskSystemNumThreads, 32 * 1024, EThreadPriority::TPri_TimeCritical);
 
+        // One more index than pool threads, for the game thread
 #if UE4_ASYNC_TASK
-        gSampleTaskSystemNumThreads = GThreadPool->GetNumThreads();
+        gSampleTaskSystemNumThreads = GThreadPool->GetNumThreads() + 1;
 #elif UE4_TASK_GRAPH
-        gSampleTaskSystemNumThreads = FTaskGraphInterface::Get().GetNumWorkerThreads();
+        gSampleTaskSystemNumThreads = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
 #elif UE4_QUEUED_WORK
-        gSampleTaskSystemNumThreads = gSampleTaskSystemQueuedThreadPool->GetNumThreads();
+        gSampleTaskSystemNumThreads = gSampleTaskSystemQueuedThreadPool->GetNumThreads() + 1;
+#endif
+
+        gSampleTaskSystemGeneration.Increment();
+        gSampleTaskSystemLastWorkerIndex.Reset();
+        gSampleTaskSystemNumRegisteredWorkers.Reset();
+        SampleClaimWorkerIndex();
+        SampleTaskTraceStartup(gSampleTaskSystemNumThreads);
+
+#if UE4_QUEUED_WORK
+        uint32_t numTaskRecords = (uint32_t)gSampleTaskSystemNumThreads * kSampleTaskRecordsPerThread;
+        if (gSampleTaskPool.GetNumInUse() == 0)
+        {
+            gSampleTaskPool.Init(numTaskRecords);
+        }
+
+        for (int i = 0; i < gSampleTaskSystemNumThreads - 1; i++)
+        {
+            gSampleTaskSystemQueuedThreadPool->AddQueuedWork(new UE4RegisterWorkerTask());
+        }
+        SampleWaitForAllThreadsToStart();
 #endif
 #elif USE_TL
         TLJobSystem::Create(numThreads, 0);
@@ -184,6 +384,7 @@ namespace AMD
         gSampleTaskSystemQueuedThreadPool->Destroy();
         delete gSampleTaskSystemQueuedThreadPool;
         gSampleTaskSystemQueuedThreadPool = nullptr;
+        SampleTaskTraceShutdown();
 #elif USE_TL
         TLJobSystem::Destroy();
 #endif
@@ -191,7 +392,12 @@ namespace AMD
 
     void SampleWaitForAllThreadsToStart()
     {
-#if USE_TL
+#if USE_UE4 && UE4_QUEUED_WORK
+        while (gSampleTaskSystemNumRegisteredWorkers.GetValue() < gSampleTaskSystemNumThreads - 1)
+        {
+            FPlatformProcess::YieldThread();
+        }
+#elif USE_TL
         TLJobSystem::Get()->WaitForAllWorkersToStart();
 #endif
     }
@@ -201,6 +407,17 @@ namespace AMD
         return gSampleTaskSystemNumThreads;
     }
 
+    // Neither the UE4 pools nor TBB can park threads
+    void SampleSetTaskSystemNumActiveThreads(int numThreads)
+    {
+        (void)numThreads;
+    }
+
+    int SampleGetTaskSystemNumActiveThreads()
+    {
+        return gSampleTaskSystemNumThreads;
+    }
+
     int SampleGetTaskSystemDefaultNumThreads()
     {
 #if USE_MULTITHREADING
@@ -230,7 +447,7 @@ namespace AMD
 #if USE_TBB
         return this_task_arena::current_thread_index();
 #elif USE_UE4
-#error "Not implemented"
+        return SampleClaimWorkerIndex();
 #elif USE_TL
         TLJobSystem* jobSys = TLJobSystem::Get();
         return jobSys->GetWorkerIndex();
@@ -256,14 +473,11 @@ namespace AMD
         task::spawn(*(task *)tbbTask);
 #elif USE_UE4
 #if UE4_ASYNC_TASK
-        (new FAutoDeleteAsyncTask<UE4Task>(TaskFunc, taskData, taskBeginIndex, taskEndIndex))->StartBackgroundTask();
+        (new FAutoDeleteAsyncTask<UE4Task>(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex))->StartBackgroundTask();
 #elif UE4_TASK_GRAPH
-        TGraphTask<UE4Task>::CreateTask(nullptr, ENamedThreads::AnyThread).ConstructAndDispatchWhenReady(TaskFunc, taskData, taskBeginIndex, taskEndIndex);
+        TGraphTask<UE4Task>::CreateTask(nullptr, ENamedThreads::AnyThread).ConstructAndDispatchWhenReady(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
 #elif UE4_QUEUED_WORK
-
-        void* mem = FMemory::Malloc(sizeof(UE4Task), alignof(UE4Task));
-        
-        UE4Task* task = new (mem) UE4Task(TaskFunc, taskData, taskBeginIndex, taskEndIndex);
+        UE4Task* task = gSampleTaskPool.New(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
 
         return gSampleTaskSystemQueuedThreadPool->AddQueuedWork(task);
 #endif
@@ -282,6 +496,27 @@ namespace AMD
 #endif
     }
 
+    // The UE4 pools and TBB have one queue for all FEM work, so classes and deadlines are not used
+    void SampleAsyncTaskWithPriority(const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex,
+        SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        (void)priority;
+        (void)deadlineNs;
+        SampleAsyncTask(taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
+    }
+
+    void SampleSetThreadTaskPriority(SampleTaskPriority priority, uint64_t deadlineNs)
+    {
+        (void)priority;
+        (void)deadlineNs;
+    }
+
+    void SampleGetThreadTaskPriority(SampleTaskPriority& outPriority, uint64_t& outDeadlineNs)
+    {
+        outPriority = SAMPLE_TASK_PRIORITY_NORMAL;
+        outDeadlineNs = 0;
+    }
+
     FmSyncEvent* SampleCreateSyncEvent()
     {
 #if USE_MULTITHREADING
@@ -365,6 +600,25 @@ namespace AMD
     }
 #endif
 
+    void SampleGetTaskSystemPoolStats(SampleTaskSystemPoolStats& outStats)
+    {
+        FMemory::Memzero(&outStats, sizeof(outStats));
+
+#if USE_UE4 && UE4_QUEUED_WORK
+        gSampleTaskPool.GetStats(outStats.numTasksInUse, outStats.peakTasksInUse, outStats.taskCapacity, outStats.numTaskOverflows);
+#endif
+        // UE4 sync events already come from the engine's event pool
+    }
+
+    void SampleSetTaskSystemWorkerStartCallback(SampleWorkerStartCallback callback)
+    {
+#if USE_UE4
+        gSampleTaskSystemWorkerStartCallback = callback;
+#else
+        (void)callback;
+#endif
+    }
+
 #if (!SAMPLE_ASYNC_THREADING || SAMPLE_LEGACY_THREADING) && USE_TBB  // only TBB supported for non-async interface
     FmTaskWaitCounter* SampleCreateTaskWaitCounter()
     {
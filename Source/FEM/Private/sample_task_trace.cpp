@@ -0,0 +1,235 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+#include "sample_task_trace.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+
+namespace AMD
+{
+    static const uint32_t kSampleTaskTraceRecordsPerThread = 16384;
+
+    struct SampleTaskTraceRecord
+    {
+        const char* taskName;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    // Written only by the thread holding the worker index, read by the exporter up to count
+    struct SampleTaskTraceBuffer
+    {
+        SampleTaskTraceRecord* records;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> numDropped;
+    };
+
+    std::atomic<bool> gSampleTaskTraceEnabled(false);
+
+    static std::mutex gSampleTaskTraceMutex;
+    static SampleTaskTraceBuffer* gSampleTaskTraceBuffers = nullptr;
+    static int gSampleTaskTraceNumBuffers = 0;
+    static int gSampleTaskTraceNumThreads = 0;
+    static uint64_t gSampleTaskTraceStartNs = 0;
+
+    static SampleTaskScopeBeginCallback gSampleTaskScopeBegin = nullptr;
+    static SampleTaskScopeEndCallback gSampleTaskScopeEnd = nullptr;
+
+    uint64_t SampleGetTaskSystemTimeNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void SampleTaskTraceFreeBuffers()
+    {
+        for (int i = 0; i < gSampleTaskTraceNumBuffers; i++)
+        {
+            delete[] gSampleTaskTraceBuffers[i].records;
+        }
+        delete[] gSampleTaskTraceBuffers;
+        gSampleTaskTraceBuffers = nullptr;
+        gSampleTaskTraceNumBuffers = 0;
+    }
+
+    // Caller holds gSampleTaskTraceMutex. Buffers are allocated on first use, sized for the current thread count.
+    static void SampleTaskTraceBeginCapture()
+    {
+        if (!gSampleTaskTraceBuffers && gSampleTaskTraceNumThreads > 0)
+        {
+            gSampleTaskTraceBuffers = new SampleTaskTraceBuffer[gSampleTaskTraceNumThreads];
+            gSampleTaskTraceNumBuffers = gSampleTaskTraceNumThreads;
+            for (int i = 0; i < gSampleTaskTraceNumBuffers; i++)
+            {
+                gSampleTaskTraceBuffers[i].records = new SampleTaskTraceRecord[kSampleTaskTraceRecordsPerThread];
+            }
+        }
+
+        for (int i = 0; i < gSampleTaskTraceNumBuffers; i++)
+        {
+            gSampleTaskTraceBuffers[i].count.store(0, std::memory_order_relaxed);
+            gSampleTaskTraceBuffers[i].numDropped.store(0, std::memory_order_relaxed);
+        }
+        gSampleTaskTraceStartNs = SampleGetTaskSystemTimeNs();
+    }
+
+    void SampleTaskTraceStartup(int numThreads)
+    {
+        std::lock_guard<std::mutex> lock(gSampleTaskTraceMutex);
+
+        SampleTaskTraceFreeBuffers();
+        gSampleTaskTraceNumThreads = numThreads;
+
+        if (gSampleTaskTraceEnabled.load(std::memory_order_relaxed))
+        {
+            SampleTaskTraceBeginCapture();
+        }
+    }
+
+    void SampleTaskTraceShutdown()
+    {
+        std::lock_guard<std::mutex> lock(gSampleTaskTraceMutex);
+
+        bool wasEnabled = gSampleTaskTraceEnabled.exchange(false, std::memory_order_relaxed);
+        SampleTaskTraceFreeBuffers();
+        gSampleTaskTraceNumThreads = 0;
+
+        // Carry the setting over to the next task system
+        gSampleTaskTraceEnabled.store(wasEnabled, std::memory_order_relaxed);
+    }
+
+    void SampleRunTracedTask(int workerIndex, const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex)
+    {
+        SampleTaskScopeBeginCallback scopeBegin = gSampleTaskScopeBegin;
+        SampleTaskScopeEndCallback scopeEnd = gSampleTaskScopeEnd;
+        if (scopeBegin)
+        {
+            scopeBegin(taskName ? taskName : "FEMFX_Task");
+        }
+
+        uint64_t startNs = SampleGetTaskSystemTimeNs();
+        TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+        uint64_t endNs = SampleGetTaskSystemTimeNs();
+
+        if (scopeBegin && scopeEnd)
+        {
+            scopeEnd();
+        }
+
+        SampleTaskTraceBuffer* buffers = gSampleTaskTraceBuffers;
+        if (!buffers || workerIndex < 0 || workerIndex >= gSampleTaskTraceNumBuffers)
+        {
+            return;
+        }
+
+        SampleTaskTraceBuffer& buffer = buffers[workerIndex];
+        uint32_t recordIdx = buffer.count.load(std::memory_order_relaxed);
+        if (recordIdx >= kSampleTaskTraceRecordsPerThread)
+        {
+            buffer.numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        SampleTaskTraceRecord& record = buffer.records[recordIdx];
+        record.taskName = taskName;
+        record.startNs = startNs;
+        record.endNs = endNs;
+        buffer.count.store(recordIdx + 1, std::memory_order_release);
+    }
+
+    void SampleSetTaskSystemTracing(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(gSampleTaskTraceMutex);
+
+        if (enable == gSampleTaskTraceEnabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        // Each enable starts a new capture
+        if (enable)
+        {
+            SampleTaskTraceBeginCapture();
+        }
+
+        gSampleTaskTraceEnabled.store(enable, std::memory_order_release);
+    }
+
+    bool SampleGetTaskSystemTracing()
+    {
+        return gSampleTaskTraceEnabled.load(std::memory_order_relaxed);
+    }
+
+    static void SampleWriteJsonString(FILE* file, const char* str)
+    {
+        fputc('"', file);
+        for (const char* c = str; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                fputc('\\', file);
+            }
+            if ((unsigned char)*c >= 0x20)
+            {
+                fputc(*c, file);
+            }
+        }
+        fputc('"', file);
+    }
+
+    bool SampleWriteTaskSystemChromeTrace(const char* path)
+    {
+        std::lock_guard<std::mutex> lock(gSampleTaskTraceMutex);
+
+        FILE* file = fopen(path, "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+        bool first = true;
+        for (int workerIdx = 0; workerIdx < gSampleTaskTraceNumBuffers; workerIdx++)
+        {
+            const SampleTaskTraceBuffer& buffer = gSampleTaskTraceBuffers[workerIdx];
+
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"FEM worker %d%s\"}}",
+                first ? "" : ",\n", workerIdx, workerIdx, workerIdx == 0 ? " (game thread)" : "");
+            first = false;
+
+            uint32_t numRecords = buffer.count.load(std::memory_order_acquire);
+            for (uint32_t recordIdx = 0; recordIdx < numRecords; recordIdx++)
+            {
+                const SampleTaskTraceRecord& record = buffer.records[recordIdx];
+                uint64_t startNs = record.startNs > gSampleTaskTraceStartNs ? record.startNs - gSampleTaskTraceStartNs : 0;
+
+                fprintf(file, ",\n{\"name\":");
+                SampleWriteJsonString(file, record.taskName ? record.taskName : "FEMFX_Task");
+                fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    workerIdx, (double)startNs * 1e-3, (double)(record.endNs - record.startNs) * 1e-3);
+            }
+
+            uint32_t numDropped = buffer.numDropped.load(std::memory_order_relaxed);
+            if (numDropped > 0)
+            {
+                fprintf(file, ",\n{\"name\":\"dropped %u tasks\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":0}", numDropped, workerIdx);
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+        bool ok = ferror(file) == 0;
+        ok = fclose(file) == 0 && ok;
+        return ok;
+    }
+
+    void SampleSetTaskSystemScopeCallbacks(SampleTaskScopeBeginCallback begin, SampleTaskScopeEndCallback end)
+    {
+        gSampleTaskScopeBegin = begin;
+        gSampleTaskScopeEnd = end;
+    }
+}
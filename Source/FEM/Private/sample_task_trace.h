@@ -0,0 +1,39 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Task timing capture shared by the sample task system backends.
+// Each worker index writes to its own fixed buffer, so recording takes no locks. When tracing is off,
+// running a task costs one relaxed load on top of the call. Only depends on the C++ standard library.
+
+#pragma once
+
+#include "sample_task_system.h"
+
+#include <atomic>
+
+namespace AMD
+{
+    extern std::atomic<bool> gSampleTaskTraceEnabled;
+
+    // Called by the backends when the task system starts and after its threads have stopped
+    void SampleTaskTraceStartup(int numThreads);
+    void SampleTaskTraceShutdown();
+
+    void SampleRunTracedTask(int workerIndex, const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex);
+
+    // Run a task on the calling worker, recording it when tracing is on
+    inline void SampleRunTask(int workerIndex, const char* taskName, FmTaskFuncCallback TaskFunc, void* taskData, int32_t taskBeginIndex, int32_t taskEndIndex)
+    {
+        if (gSampleTaskTraceEnabled.load(std::memory_order_relaxed))
+        {
+            SampleRunTracedTask(workerIndex, taskName, TaskFunc, taskData, taskBeginIndex, taskEndIndex);
+        }
+        else
+        {
+            TaskFunc(taskData, taskBeginIndex, taskEndIndex);
+        }
+    }
+}
@@ -3,8 +3,10 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(FEMLog, Warning, All);
+DECLARE_STATS_GROUP(TEXT("FEM"), STATGROUP_FEM, STATCAT_Advanced);
 
 class FFEMModule final : public IModuleInterface
 {
@@ -12,4 +14,38 @@ public:
 	virtual void StartupModule() override;
 	
 	virtual void ShutdownModule() override;
+
+	static FFEMModule& Get() { return FModuleManager::LoadModuleChecked<FFEMModule>(TEXT("FEM")); }
+
+	/**
+	 * The FEMFX task system is process wide, so it is shared by every scene in every world.
+	 * The first acquire starts the worker threads, the last release stops them. Returns the number of worker threads.
+	 */
+	int32 AcquireTaskSystem();
+	void ReleaseTaskSystem();
+
+	int32 GetTaskSystemNumThreads() const { return TaskSystemNumThreads; }
+
+	/**
+	 * How many task system threads take work, clamped to GetTaskSystemNumThreads(). Threads above it are parked rather than
+	 * destroyed, so this can be changed at any time without a hitch. 0 returns to the count picked from the config.
+	 */
+	void SetTaskSystemActiveThreads(int32 NumThreads);
+	int32 GetTaskSystemActiveThreads() const;
+
+	/**
+	 * Thread count found by AFEMFXScene::CalibrateWorkerThreads on this machine, 0 if it hasn't been calibrated.
+	 * Saved in the [FEM.Calibration] section of the saved Engine config with the CPU it was measured on, and used
+	 * in place of the topology default when [FEM] NumWorkerThreads isn't set. Setting it also applies it.
+	 */
+	int32 GetCalibratedWorkerThreads() const;
+	void SetCalibratedWorkerThreads(int32 NumThreads);
+
+private:
+	FCriticalSection TaskSystemLock;
+	int32 TaskSystemRefCount = 0;
+	int32 TaskSystemNumThreads = 0;
+
+	/** Active thread count picked from the config when the task system started, what SetTaskSystemActiveThreads(0) returns to */
+	int32 TaskSystemConfiguredThreads = 0;
 };
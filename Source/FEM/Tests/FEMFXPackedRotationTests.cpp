@@ -0,0 +1,258 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Round trip and hemisphere tests for the snorm16 quaternion encoding in FEMFXPackedRotation.h, built by Tests/CMakeLists.txt.
+// UnrealBuildTool compiles every source under the module, so the file is empty unless that target defines FEM_STANDALONE_TESTS.
+
+#ifdef FEM_STANDALONE_TESTS
+
+#include "FEMFXPackedRotation.h"
+
+#include <math.h>
+#include <random>
+#include <stdio.h>
+
+static int gNumFailures = 0;
+
+#define TEST_CHECK(Condition) \
+    do { if (!(Condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition); gNumFailures++; } } while (0)
+
+// Bound promised by UnpackFEMFXRotation
+static const float kMaxAngleError = 1e-4f;
+
+static float Dot(const float A[4], const float B[4])
+{
+    return A[0] * B[0] + A[1] * B[1] + A[2] * B[2] + A[3] * B[3];
+}
+
+// Angle of the rotation taking A to B, the same for either sign of each. From the chord rather than acos of the dot
+// product, which in float can't resolve angles this small.
+static float AngleBetween(const float A[4], const float B[4])
+{
+    double Sign = Dot(A, B) < 0.0f ? -1.0 : 1.0;
+    double ChordSquared = 0.0;
+    for (int Idx = 0; Idx < 4; Idx++)
+    {
+        double Delta = (double)A[Idx] - Sign * B[Idx];
+        ChordSquared += Delta * Delta;
+    }
+    return (float)(4.0 * asin(fmin(sqrt(ChordSquared) * 0.5, 1.0)));
+}
+
+static void RandomUnitQuat(std::mt19937& Random, float Out[4])
+{
+    std::normal_distribution<float> Normal;
+    float Length = 0.0f;
+    while (Length < 1e-3f)
+    {
+        for (int Idx = 0; Idx < 4; Idx++)
+        {
+            Out[Idx] = Normal(Random);
+        }
+        Length = sqrtf(Dot(Out, Out));
+    }
+
+    for (int Idx = 0; Idx < 4; Idx++)
+    {
+        Out[Idx] /= Length;
+    }
+}
+
+static void RoundTrip(const float Quat[4], float Out[4])
+{
+    int16_t Packed[4];
+    PackFEMFXQuatSnorm16(Packed, Quat);
+    UnpackFEMFXQuatSnorm16(Out, Packed);
+}
+
+static void TestScalarEncoding()
+{
+    TEST_CHECK(EncodeFEMFXSnorm16(1.0f) == 32767);
+    TEST_CHECK(EncodeFEMFXSnorm16(-1.0f) == -32767);
+    TEST_CHECK(EncodeFEMFXSnorm16(0.0f) == 0);
+
+    // Sums slightly over unit length saturate instead of wrapping
+    TEST_CHECK(EncodeFEMFXSnorm16(1.001f) == 32767);
+    TEST_CHECK(EncodeFEMFXSnorm16(-1.001f) == -32768);
+
+    TEST_CHECK(DecodeFEMFXSnorm16(32767) == 1.0f);
+    TEST_CHECK(DecodeFEMFXSnorm16(-32767) == -1.0f);
+    TEST_CHECK(DecodeFEMFXSnorm16(-32768) == -1.0f);
+
+    // Encode and decode are odd, so negating a quaternion negates its encoding exactly
+    for (int Value = -32767; Value <= 32767; Value += 97)
+    {
+        float Decoded = DecodeFEMFXSnorm16((int16_t)Value);
+        TEST_CHECK(EncodeFEMFXSnorm16(Decoded) == Value);
+        TEST_CHECK(EncodeFEMFXSnorm16(-Decoded) == -Value);
+    }
+}
+
+static void TestRoundTripPrecision()
+{
+    std::mt19937 Random(12345);
+
+    float MaxAngle = 0.0f;
+    for (int Iteration = 0; Iteration < 100000; Iteration++)
+    {
+        float Quat[4], Decoded[4];
+        RandomUnitQuat(Random, Quat);
+        RoundTrip(Quat, Decoded);
+
+        MaxAngle = fmaxf(MaxAngle, AngleBetween(Quat, Decoded));
+        TEST_CHECK(fabsf(Dot(Decoded, Decoded) - 1.0f) < 1e-5f);
+    }
+    TEST_CHECK(MaxAngle < kMaxAngleError);
+
+    // Axis aligned and half turn rotations, where one or more components are zero or at the ends of the range
+    const float Cases[][4] =
+    {
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, 0.0f, -1.0f },
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, -1.0f, 0.0f, 0.0f },
+        { 0.70710678f, 0.0f, 0.0f, 0.70710678f },
+        { 0.0f, 0.0f, -0.70710678f, 0.70710678f },
+        { 0.5f, -0.5f, 0.5f, -0.5f },
+    };
+    for (const float* Quat : Cases)
+    {
+        float Decoded[4];
+        RoundTrip(Quat, Decoded);
+        TEST_CHECK(AngleBetween(Quat, Decoded) < kMaxAngleError);
+        for (int Idx = 0; Idx < 4; Idx++)
+        {
+            TEST_CHECK(fabsf(Decoded[Idx] - Quat[Idx]) < 1e-4f);
+        }
+    }
+
+    // Unnormalized input, e.g. a vertex's sum of tet quaternions
+    const float Sum[4] = { 0.4f, -1.2f, 2.0f, 0.8f };
+    float Normalized[4], Decoded[4];
+    float Length = sqrtf(Dot(Sum, Sum));
+    for (int Idx = 0; Idx < 4; Idx++)
+    {
+        Normalized[Idx] = Sum[Idx] / Length;
+    }
+    RoundTrip(Sum, Decoded);
+    TEST_CHECK(AngleBetween(Normalized, Decoded) < kMaxAngleError);
+
+    // A degenerate sum decodes to the identity rather than NaNs
+    const float Zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    RoundTrip(Zero, Decoded);
+    TEST_CHECK(Decoded[0] == 0.0f && Decoded[1] == 0.0f && Decoded[2] == 0.0f && Decoded[3] == 1.0f);
+}
+
+// Mirrors the blend in FEMFXMeshVertexFactory.ush: the other quaternions are flipped into the hemisphere of the first
+static void BlendAligned(float Out[4], const float Quats[][4], const float Weights[], int NumQuats)
+{
+    for (int Idx = 0; Idx < 4; Idx++)
+    {
+        Out[Idx] = Quats[0][Idx] * Weights[0];
+    }
+    for (int QuatIdx = 1; QuatIdx < NumQuats; QuatIdx++)
+    {
+        float Weight = Dot(Quats[0], Quats[QuatIdx]) < 0.0f ? -Weights[QuatIdx] : Weights[QuatIdx];
+        for (int Idx = 0; Idx < 4; Idx++)
+        {
+            Out[Idx] += Quats[QuatIdx][Idx] * Weight;
+        }
+    }
+
+    float Length = sqrtf(Dot(Out, Out));
+    for (int Idx = 0; Idx < 4; Idx++)
+    {
+        Out[Idx] /= Length;
+    }
+}
+
+static void TestHemispheres()
+{
+    std::mt19937 Random(54321);
+
+    for (int Iteration = 0; Iteration < 10000; Iteration++)
+    {
+        float Quat[4], Negated[4];
+        RandomUnitQuat(Random, Quat);
+        for (int Idx = 0; Idx < 4; Idx++)
+        {
+            Negated[Idx] = -Quat[Idx];
+        }
+
+        // The encode keeps the sign it was given, q and -q encode to exact negations of each other
+        int16_t Packed[4], PackedNegated[4];
+        PackFEMFXQuatSnorm16(Packed, Quat);
+        PackFEMFXQuatSnorm16(PackedNegated, Negated);
+        for (int Idx = 0; Idx < 4; Idx++)
+        {
+            TEST_CHECK(PackedNegated[Idx] == -Packed[Idx]);
+        }
+
+        float Decoded[4];
+        UnpackFEMFXQuatSnorm16(Decoded, Packed);
+        TEST_CHECK(Dot(Quat, Decoded) > 0.0f);
+
+        // Two vertices with the same rotation, stored in opposite hemispheres. Blending them without flipping
+        // one would cancel out; aligned, the blend stays within quantization error of the rotation.
+        float Quats[2][4];
+        UnpackFEMFXQuatSnorm16(Quats[0], Packed);
+        UnpackFEMFXQuatSnorm16(Quats[1], PackedNegated);
+
+        const float Weights[2] = { 0.5f, 0.5f };
+        float Blended[4];
+        BlendAligned(Blended, Quats, Weights, 2);
+        TEST_CHECK(AngleBetween(Quat, Blended) < kMaxAngleError);
+    }
+
+    // Blending packed rotations spread over both hemispheres matches blending the originals
+    for (int Iteration = 0; Iteration < 10000; Iteration++)
+    {
+        float Base[4];
+        RandomUnitQuat(Random, Base);
+
+        float Originals[4][4], Decoded[4][4];
+        std::uniform_real_distribution<float> Offset(-0.1f, 0.1f);
+        for (int QuatIdx = 0; QuatIdx < 4; QuatIdx++)
+        {
+            float Sign = (QuatIdx & 1) ? -1.0f : 1.0f;
+            float Length = 0.0f;
+            for (int Idx = 0; Idx < 4; Idx++)
+            {
+                Originals[QuatIdx][Idx] = Sign * (Base[Idx] + Offset(Random));
+                Length += Originals[QuatIdx][Idx] * Originals[QuatIdx][Idx];
+            }
+            for (int Idx = 0; Idx < 4; Idx++)
+            {
+                Originals[QuatIdx][Idx] /= sqrtf(Length);
+            }
+            RoundTrip(Originals[QuatIdx], Decoded[QuatIdx]);
+        }
+
+        const float Weights[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+        float Expected[4], Blended[4];
+        BlendAligned(Expected, Originals, Weights, 4);
+        BlendAligned(Blended, Decoded, Weights, 4);
+        TEST_CHECK(AngleBetween(Expected, Blended) < kMaxAngleError);
+    }
+}
+
+int main()
+{
+    TestScalarEncoding();
+    TestRoundTripPrecision();
+    TestHemispheres();
+
+    if (gNumFailures > 0)
+    {
+        printf("%d checks failed\n", gNumFailures);
+        return 1;
+    }
+
+    printf("All packed rotation tests passed\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,558 @@
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2019 Advanced Micro Devices, Inc. All rights reserved.
+//
+//---------------------------------------------------------------------------------------
+
+// Stress tests for the native task system, its queues and the object pool, built by Tests/CMakeLists.txt.
+// UnrealBuildTool compiles every source under the module, so the file is empty unless that target defines FEM_STANDALONE_TESTS.
+
+#ifdef FEM_STANDALONE_TESTS
+
+#include "native_task_system.h"
+#include "native_task_queues.h"
+#include "sample_object_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace AMD;
+
+static int gNumFailures = 0;
+
+#define TEST_CHECK(Condition) \
+    do { if (!(Condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition); gNumFailures++; } } while (0)
+
+static NativeTask MakeTask(int32_t id)
+{
+    NativeTask task = {};
+    task.taskBeginIndex = id;
+    task.taskEndIndex = id + 1;
+    return task;
+}
+
+// Every id in [0, numIds) was taken exactly once
+static bool AllTakenOnce(const std::vector<std::atomic<int>>& counts)
+{
+    for (const std::atomic<int>& count : counts)
+    {
+        if (count.load() != 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TestDequeOrder()
+{
+    NativeWorkStealingDeque* deque = new NativeWorkStealingDeque();
+    NativeTask task;
+
+    TEST_CHECK(!deque->Pop(task));
+    TEST_CHECK(!deque->Steal(task));
+
+    for (int32_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(deque->Push(MakeTask(i)));
+    }
+
+    // The owner takes the newest task, thieves the oldest
+    TEST_CHECK(deque->Pop(task) && task.taskBeginIndex == 2);
+    TEST_CHECK(deque->Steal(task) && task.taskBeginIndex == 0);
+    TEST_CHECK(deque->Pop(task) && task.taskBeginIndex == 1);
+    TEST_CHECK(!deque->Pop(task));
+
+    for (int32_t i = 0; i < (int32_t)kNativeDequeCapacity; i++)
+    {
+        TEST_CHECK(deque->Push(MakeTask(i)));
+    }
+    TEST_CHECK(!deque->Push(MakeTask(-1)));
+
+    delete deque;
+}
+
+static void TestDequeContention()
+{
+    const int numThieves = 4;
+    const int32_t numTasks = 200000;
+
+    NativeWorkStealingDeque* deque = new NativeWorkStealingDeque();
+    std::vector<std::atomic<int>> counts(numTasks);
+    for (std::atomic<int>& count : counts)
+    {
+        count.store(0);
+    }
+
+    std::atomic<bool> ownerDone(false);
+    std::vector<std::thread> thieves;
+    for (int thiefIdx = 0; thiefIdx < numThieves; thiefIdx++)
+    {
+        thieves.emplace_back([&]()
+        {
+            NativeTask task;
+            while (!ownerDone.load(std::memory_order_acquire))
+            {
+                if (deque->Steal(task))
+                {
+                    counts[task.taskBeginIndex].fetch_add(1);
+                }
+            }
+        });
+    }
+
+    // Interleave pushes with pops, so the owner races thieves for the last task in the deque as often as possible
+    NativeTask task;
+    int32_t nextId = 0;
+    while (nextId < numTasks)
+    {
+        int32_t batch = 1 + nextId % 7;
+        for (int32_t i = 0; i < batch && nextId < numTasks; i++)
+        {
+            if (deque->Push(MakeTask(nextId)))
+            {
+                nextId++;
+            }
+        }
+
+        if (deque->Pop(task))
+        {
+            counts[task.taskBeginIndex].fetch_add(1);
+        }
+    }
+    while (deque->Pop(task))
+    {
+        counts[task.taskBeginIndex].fetch_add(1);
+    }
+
+    ownerDone.store(true, std::memory_order_release);
+    for (std::thread& thief : thieves)
+    {
+        thief.join();
+    }
+
+    TEST_CHECK(AllTakenOnce(counts));
+    delete deque;
+}
+
+static void TestInjectionQueue()
+{
+    const int numProducers = 4;
+    const int numConsumers = 4;
+    const int32_t numTasksPerProducer = 100000;
+    const int32_t numTasks = numProducers * numTasksPerProducer;
+
+    NativeInjectionQueue* queue = new NativeInjectionQueue();
+    NativeTask task;
+
+    for (size_t i = 0; i < kNativeInjectionCapacity; i++)
+    {
+        TEST_CHECK(queue->Push(MakeTask((int32_t)i)));
+    }
+    TEST_CHECK(!queue->Push(MakeTask(-1)));
+    for (size_t i = 0; i < kNativeInjectionCapacity; i++)
+    {
+        TEST_CHECK(queue->Pop(task) && task.taskBeginIndex == (int32_t)i);
+    }
+    TEST_CHECK(!queue->Pop(task));
+
+    std::vector<std::atomic<int>> counts(numTasks);
+    for (std::atomic<int>& count : counts)
+    {
+        count.store(0);
+    }
+
+    std::atomic<int32_t> numTaken(0);
+    std::vector<std::thread> threads;
+    for (int producerIdx = 0; producerIdx < numProducers; producerIdx++)
+    {
+        threads.emplace_back([&, producerIdx]()
+        {
+            for (int32_t i = 0; i < numTasksPerProducer; i++)
+            {
+                // Full while consumers catch up
+                while (!queue->Push(MakeTask(producerIdx * numTasksPerProducer + i)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int consumerIdx = 0; consumerIdx < numConsumers; consumerIdx++)
+    {
+        threads.emplace_back([&]()
+        {
+            NativeTask consumed;
+            while (numTaken.load() < numTasks)
+            {
+                if (queue->Pop(consumed))
+                {
+                    counts[consumed.taskBeginIndex].fetch_add(1);
+                    numTaken.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    TEST_CHECK(numTaken.load() == numTasks);
+    TEST_CHECK(AllTakenOnce(counts));
+    TEST_CHECK(!queue->Pop(task));
+    delete queue;
+}
+
+struct PoolTestObject
+{
+    std::atomic<int> owner;
+};
+
+namespace AMD
+{
+    struct SampleObjectPoolTestAccess
+    {
+        template<class T>
+        static uint64_t GetHead(const SampleObjectPool<T>& pool)
+        {
+            return pool.head.load();
+        }
+    };
+}
+
+static void TestObjectPool()
+{
+    const uint32_t capacity = 4;
+    const int numThreads = 8;
+    const int numIterations = 500000;
+
+    SampleObjectPool<PoolTestObject> pool;
+    pool.Init(capacity);
+
+    // Slots are handed out once each, then the pool overflows to the heap
+    std::vector<PoolTestObject*> objects;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        objects.push_back(pool.New());
+        TEST_CHECK(pool.Owns(objects.back()));
+        for (uint32_t j = 0; j < i; j++)
+        {
+            TEST_CHECK(objects[j] != objects[i]);
+        }
+    }
+    PoolTestObject* overflow = pool.New();
+    TEST_CHECK(!pool.Owns(overflow));
+    pool.Delete(overflow);
+    for (PoolTestObject* object : objects)
+    {
+        pool.Delete(object);
+    }
+
+    int32_t numInUse, peakInUse, poolCapacity, numOverflows;
+    pool.GetStats(numInUse, peakInUse, poolCapacity, numOverflows);
+    TEST_CHECK(numInUse == 0 && peakInUse == (int32_t)capacity && poolCapacity == (int32_t)capacity && numOverflows == 1);
+
+    // A thread that read the head, then lost the CPU while another popped that slot and the one after it and pushed the
+    // first back, finds the same index at the head again. Its CAS may only fail if the head value itself changed.
+    uint64_t staleHead = SampleObjectPoolTestAccess::GetHead(pool);
+    void* first = pool.Allocate();
+    void* second = pool.Allocate();
+    pool.Free(first);
+    uint64_t head = SampleObjectPoolTestAccess::GetHead(pool);
+    TEST_CHECK((uint32_t)head == (uint32_t)staleHead);
+    TEST_CHECK(head != staleHead);
+    pool.Free(second);
+
+    // Threads churn a free list shorter than their number without pausing, so one is regularly preempted between reading
+    // the head and its CAS while others pop that slot and the one after it, then push the first back. Without the tag,
+    // the stale CAS would succeed and put a slot that is in use back at the head, handing it to two threads at once.
+    std::atomic<int> numDoubleOwners(0);
+    std::vector<std::thread> threads;
+    for (int threadIdx = 0; threadIdx < numThreads; threadIdx++)
+    {
+        threads.emplace_back([&, threadIdx]()
+        {
+            for (int i = 0; i < numIterations; i++)
+            {
+                PoolTestObject* first = (PoolTestObject*)pool.Allocate();
+                PoolTestObject* second = (PoolTestObject*)pool.Allocate();
+                if (first)
+                {
+                    first->owner.store(threadIdx, std::memory_order_relaxed);
+                }
+                if (second)
+                {
+                    second->owner.store(threadIdx, std::memory_order_relaxed);
+                }
+
+                if ((first && first->owner.load(std::memory_order_relaxed) != threadIdx) || (second && (second == first || second->owner.load(std::memory_order_relaxed) != threadIdx)))
+                {
+                    numDoubleOwners.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (first)
+                {
+                    pool.Free(first);
+                }
+                if (second && second != first)
+                {
+                    pool.Free(second);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    TEST_CHECK(numDoubleOwners.load() == 0);
+    TEST_CHECK(pool.GetNumInUse() == 0);
+
+    // The free list still holds every slot exactly once
+    std::vector<void*> slots;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        slots.push_back(pool.Allocate());
+        TEST_CHECK(slots.back() != nullptr);
+        for (uint32_t j = 0; j < i; j++)
+        {
+            TEST_CHECK(slots[j] != slots[i]);
+        }
+    }
+    TEST_CHECK(pool.Allocate() == nullptr);
+    for (void* slot : slots)
+    {
+        pool.Free(slot);
+    }
+}
+
+// Waits up to a second for the condition, so a broken wakeup fails the test instead of hanging it
+template<class Condition>
+static bool WaitUntil(Condition condition)
+{
+    std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > timeout)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+struct CountTaskData
+{
+    std::atomic<int> numRun;
+    std::atomic<int> numRunOutsidePool;
+    std::atomic<int> maxWorkerIndex;
+    int numTasks;
+    void* doneEvent;
+};
+
+static void CountTask(void* taskData, int32_t, int32_t)
+{
+    CountTaskData* data = (CountTaskData*)taskData;
+
+    int workerIndex = NativeGetTaskSystemWorkerIndex();
+    if (workerIndex == 0)
+    {
+        data->numRunOutsidePool.fetch_add(1);
+    }
+    int maxIndex = data->maxWorkerIndex.load();
+    while (workerIndex > maxIndex && !data->maxWorkerIndex.compare_exchange_weak(maxIndex, workerIndex))
+    {
+    }
+
+    if (data->numRun.fetch_add(1) + 1 == data->numTasks)
+    {
+        NativeTriggerSyncEvent(data->doneEvent);
+    }
+}
+
+static void InitCountTaskData(CountTaskData& data, int numTasks)
+{
+    data.numRun.store(0);
+    data.numRunOutsidePool.store(0);
+    data.maxWorkerIndex.store(0);
+    data.numTasks = numTasks;
+    data.doneEvent = NativeCreateSyncEvent();
+}
+
+struct BlockerTaskData
+{
+    std::atomic<bool> started;
+    std::atomic<bool> release;
+};
+
+static void BlockerTask(void* taskData, int32_t, int32_t)
+{
+    BlockerTaskData* data = (BlockerTaskData*)taskData;
+    data->started.store(true);
+    WaitUntil([data]() { return data->release.load(); });
+}
+
+struct BarrierTaskData
+{
+    std::atomic<int> numArrived;
+    int numParticipants;
+    std::atomic<int> numTimedOut;
+};
+
+// Only completes if numParticipants threads run it at the same time
+static void BarrierTask(void* taskData, int32_t, int32_t)
+{
+    BarrierTaskData* data = (BarrierTaskData*)taskData;
+    data->numArrived.fetch_add(1);
+    if (!WaitUntil([data]() { return data->numArrived.load() >= data->numParticipants; }))
+    {
+        data->numTimedOut.fetch_add(1);
+    }
+}
+
+static void TestTaskSystem()
+{
+    const int numThreads = 4;
+
+    // The default counts the game thread at index 0 as one of the hardware threads
+    int numHardwareThreads = (int)std::thread::hardware_concurrency();
+    TEST_CHECK(NativeGetTaskSystemDefaultNumThreads() == (numHardwareThreads > 2 ? numHardwareThreads : 2));
+
+    NativeInitTaskSystem(numThreads);
+    NativeWaitForAllThreadsToStart();
+    TEST_CHECK(NativeGetTaskSystemNumThreads() == numThreads);
+
+    // Plain submit and wait
+    CountTaskData counted;
+    InitCountTaskData(counted, 1000);
+    for (int i = 0; i < counted.numTasks; i++)
+    {
+        NativeSubmitAsyncTask("Count", CountTask, &counted, i, i + 1);
+    }
+    NativeWaitForSyncEvent(counted.doneEvent);
+    NativeDestroySyncEvent(counted.doneEvent);
+    TEST_CHECK(counted.numRun.load() == counted.numTasks);
+
+    // Park every worker but index 1, then keep it busy. Tasks from the owner thread go to the injection queue,
+    // which parked workers don't take from, so the waiting owner thread has to run them all itself.
+    NativeSetTaskSystemNumActiveThreads(2);
+    TEST_CHECK(NativeGetTaskSystemNumActiveThreads() == 2);
+
+    // A worker that read the active count just before it changed may still take one task, give it time to come around its loop
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    BlockerTaskData blocker;
+    blocker.started.store(false);
+    blocker.release.store(false);
+    NativeSubmitAsyncTask("Blocker", BlockerTask, &blocker, 0, 1);
+    TEST_CHECK(WaitUntil([&blocker]() { return blocker.started.load(); }));
+
+    InitCountTaskData(counted, 100);
+    for (int i = 0; i < counted.numTasks; i++)
+    {
+        NativeSubmitAsyncTask("Count", CountTask, &counted, i, i + 1);
+    }
+    NativeWaitForSyncEvent(counted.doneEvent);
+    NativeDestroySyncEvent(counted.doneEvent);
+    TEST_CHECK(counted.numRun.load() == counted.numTasks);
+    TEST_CHECK(counted.numRunOutsidePool.load() == counted.numTasks);
+    blocker.release.store(true);
+
+    // Unparking has to wake the parked workers: the barrier needs one task running on each worker at once
+    NativeSetTaskSystemNumActiveThreads(numThreads);
+    BarrierTaskData barrier;
+    barrier.numArrived.store(0);
+    barrier.numParticipants = numThreads - 1;
+    barrier.numTimedOut.store(0);
+    for (int i = 0; i < barrier.numParticipants; i++)
+    {
+        NativeSubmitAsyncTask("Barrier", BarrierTask, &barrier, i, i + 1);
+    }
+    TEST_CHECK(WaitUntil([&barrier]() { return barrier.numArrived.load() >= barrier.numParticipants; }));
+
+    // Joins the workers, so the barrier tasks have returned after this
+    NativeDestroyTaskSystem();
+    TEST_CHECK(barrier.numTimedOut.load() == 0);
+
+    SampleTaskSystemPoolStats stats;
+    NativeGetTaskSystemPoolStats(stats);
+    TEST_CHECK(stats.numEventsInUse == 0);
+}
+
+struct PriorityTaskData
+{
+    std::atomic<bool> done;
+    std::atomic<int> priority;
+};
+
+static void PriorityTask(void* taskData, int32_t, int32_t)
+{
+    PriorityTaskData* data = (PriorityTaskData*)taskData;
+
+    // What the task's own submissions inherit
+    SampleTaskPriority priority;
+    uint64_t deadlineNs;
+    NativeGetThreadTaskPriority(priority, deadlineNs);
+    data->priority.store(priority);
+    data->done.store(true);
+}
+
+static void TestDeadlinePromotion()
+{
+    const uint64_t waitNs = 20000000;
+
+    NativeInitTaskSystem(2);
+    NativeWaitForAllThreadsToStart();
+
+    PriorityTaskData data;
+    data.done.store(false);
+    data.priority.store(-1);
+
+    // Far from its deadline when submitted, but only taken once the single worker is free again, after the deadline got close
+    BlockerTaskData blocker;
+    blocker.started.store(false);
+    blocker.release.store(false);
+    NativeSubmitAsyncTask("Blocker", BlockerTask, &blocker, 0, 1);
+    TEST_CHECK(WaitUntil([&blocker]() { return blocker.started.load(); }));
+
+    NativeSubmitAsyncTaskWithPriority("Priority", PriorityTask, &data, 0, 1, SAMPLE_TASK_PRIORITY_NORMAL, SampleGetTaskSystemTimeNs() + waitNs);
+    std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+    blocker.release.store(true);
+    TEST_CHECK(WaitUntil([&data]() { return data.done.load(); }));
+    TEST_CHECK(data.priority.load() == SAMPLE_TASK_PRIORITY_CRITICAL);
+
+    // Without a deadline the class is kept
+    data.done.store(false);
+    NativeSubmitAsyncTaskWithPriority("Priority", PriorityTask, &data, 0, 1, SAMPLE_TASK_PRIORITY_BACKGROUND, 0);
+    TEST_CHECK(WaitUntil([&data]() { return data.done.load(); }));
+    TEST_CHECK(data.priority.load() == SAMPLE_TASK_PRIORITY_BACKGROUND);
+
+    NativeDestroyTaskSystem();
+}
+
+int main()
+{
+    TestDequeOrder();
+    TestDequeContention();
+    TestInjectionQueue();
+    TestObjectPool();
+    TestTaskSystem();
+    TestDeadlinePromotion();
+
+    if (gNumFailures > 0)
+    {
+        printf("%d checks failed\n", gNumFailures);
+        return 1;
+    }
+
+    printf("All native task system tests passed\n");
+    return 0;
+}
+
+#endif